@@ -0,0 +1,36 @@
+#ifndef COUNTING_ALLOCATOR_HPP
+#define COUNTING_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+
+//统计通过分配器申请的次数、还没有释放的字节数和它的峰值
+long long live_bytes = 0, peak_bytes = 0, allocations = 0;
+//fail_at 不为 -1 时，第 fail_at 次申请（从 0 开始数 allocations）抛出 std::bad_alloc，用来测试异常安全
+long long fail_at = -1;
+template<class T>
+class counting_allocator{
+public:
+    typedef T value_type;
+    counting_allocator(){}
+    template<class U>
+    counting_allocator(const counting_allocator<U> &){}
+    T *allocate(size_t n){
+        if(allocations == fail_at){
+            fail_at = -1;
+            throw std::bad_alloc();
+        }
+        live_bytes += n * sizeof(T);
+        if(live_bytes > peak_bytes) peak_bytes = live_bytes;
+        allocations++;
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t n){
+        live_bytes -= n * sizeof(T);
+        ::operator delete(p);
+    }
+    bool operator==(const counting_allocator &) const {return true;}
+    bool operator!=(const counting_allocator &) const {return false;}
+};
+
+#endif
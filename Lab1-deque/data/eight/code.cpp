@@ -0,0 +1,242 @@
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <type_traits>
+#include <vector>
+#include "ring_deque.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+int N = 100000;
+const size_t CAP = 1000;
+/***************************/
+
+
+class T{
+private:
+    int x;
+public:
+    T(int x):x(x){}
+    int num()const {return x;}
+    void change(int y){
+        x = y;
+    }
+};
+bool operator == (const T &a, const T &b){
+    return a.num() == b.num();
+}
+bool operator != (const T &a, const T &b){
+    return a.num() != b.num();
+}
+typedef sjtu::ring_deque<T, sjtu::ring_full::reject> reject_type;
+typedef sjtu::ring_deque<T, sjtu::ring_full::overwrite> overwrite_type;
+template<class Q>
+bool equal(Q &q, std::deque<T> &stl){
+    if(q.size() != stl.size()) return 0;
+    if(q.empty() != stl.empty()) return 0;
+    typename Q::iterator it_q = q.begin();
+    std::deque<T>::iterator it_stl = stl.begin();
+    for(; it_q != q.end() || it_stl != stl.end(); it_q++, it_stl++)
+        if(*it_q != *it_stl) return 0;
+    return 1;
+}
+void test1(){
+    printf("test1: capacity                      ");
+    reject_type q(CAP);
+    if(q.capacity() != 1024 || !q.empty() || q.full()){puts("Wrong Answer");return;}
+    reject_type p(1024);
+    if(p.capacity() != 1024){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: push & pop                    ");
+    reject_type q(CAP);
+    std::deque<T> stl;
+    for(int i=1;i<=N;i++){
+        if(i % 10 <= 3) q.push_back(T(i)), stl.push_back(T(i));else
+        if(i % 10 <= 7) q.push_front(T(i)), stl.push_front(T(i));else
+        if(i % 10 <= 8) q.pop_back(), stl.pop_back();else
+        if(i % 10 <= 9) q.pop_front(), stl.pop_front();
+        if(q.size() == q.capacity()){
+            while (q.size() > 10) q.pop_back(), stl.pop_back();
+        }
+    }
+    if(!equal(q, stl)){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: reject when full              ");
+    reject_type q(CAP);
+    for(int i=0;i<1024;i++) q.push_back(T(i));
+    if(!q.full()){puts("Wrong Answer");return;}
+    int flag = 0;
+    try{
+        q.push_back(T(-1));
+    }catch(sjtu::container_is_full &){flag ++;}
+    try{
+        q.push_front(T(-1));
+    }catch(sjtu::container_is_full &){flag ++;}
+    if(q.try_push_back(T(-1)) || q.try_push_front(T(-1))) flag = 0;
+    if(flag != 2){puts("Wrong Answer");return;}
+    if(q.front() != T(0) || q.back() != T(1023) || q.size() != 1024){puts("Wrong Answer");return;}
+    q.pop_front();
+    if(!q.try_push_back(T(1024)) || q.back() != T(1024)){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test4(){
+    printf("test4: overwrite when full           ");
+    overwrite_type q(CAP);
+    std::deque<T> stl;
+    for(int i=0;i<N;i++){
+        if(i % 3 == 0){
+            q.push_front(T(i));
+            if(stl.size() == 1024) stl.pop_back();
+            stl.push_front(T(i));
+        }else{
+            q.push_back(T(i));
+            if(stl.size() == 1024) stl.pop_front();
+            stl.push_back(T(i));
+        }
+    }
+    if(!q.full() || !equal(q, stl)){puts("Wrong Answer");return;}
+    q.push_back(q.front());
+    stl.push_back(stl.front());
+    stl.pop_front();
+    if(!equal(q, stl)){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test5(){
+    printf("test5: at & [] & itetator            ");
+    overwrite_type q(CAP);
+    std::deque<T> stl;
+    int flag = 0;
+    try{
+        q.front();
+    }catch(sjtu::container_is_empty &){flag ++;}
+    try{
+        q.pop_back();
+    }catch(sjtu::container_is_empty &){flag ++;}
+    if(flag != 2){puts("Wrong Answer");return;}
+    for(int i=0;i<5000;i++){
+        q.push_back(T(i));
+        if(stl.size() == 1024) stl.pop_front();
+        stl.push_back(T(i));
+    }
+    try{
+        q.at(q.size());
+    }catch(sjtu::index_out_of_bound &){flag ++;}
+    if(flag != 3){puts("Wrong Answer");return;}
+    for(int i=0;i<1000;i++){
+        int t1 = rand() % q.size();
+        int t2 = rand() % q.size();
+        if(q[t1] != stl[t1] || q.at(t2) != stl.at(t2)){puts("Wrong Answer");return;}
+        if(*(q.begin() + t1) != *(stl.begin() + t1)){puts("Wrong Answer");return;}
+        if(t2 && *(q.end() - t2) != *(stl.end() - t2)){puts("Wrong Answer");return;}
+        if((q.begin() + t1) - (q.begin() + t2) != (t1 - t2)){puts("Wrong Answer");return;}
+        if((q.cbegin() + t1) -> num() != stl[t1].num()){puts("Wrong Answer");return;}
+    }
+    //另一端的 push 和 pop 不会让 iterator 失效，被丢掉的元素的 iterator 会失效
+    overwrite_type::iterator it = q.begin() + 10;
+    q.pop_back();
+    q.push_back(T(-1));
+    if(*it != stl[10]){puts("Wrong Answer");return;}
+    it = q.begin();
+    q.push_back(T(-2));
+    try{
+        *it;
+    }catch(sjtu::invalid_iterator &){flag ++;}
+    overwrite_type other(CAP);
+    try{
+        q.begin() - other.begin();
+    }catch(sjtu::invalid_iterator &){flag ++;}
+    if(flag != 5){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test6(){
+    printf("test6: clear & copy & assignment     ");
+    reject_type q(CAP);
+    std::deque<T> stl;
+    for(int i=0;i<1000;i++) q.push_front(T(i)), stl.push_front(T(i));
+    reject_type p(q), r(1);
+    r = q;
+    q.clear();
+    if(!q.empty() || q.size() != 0 || q.begin() != q.end()){puts("Wrong Answer");return;}
+    q=q=q;
+    if(!q.empty()){puts("Wrong Answer");return;}
+    if(!equal(p, stl) || !equal(r, stl) || r.capacity() != 1024){puts("Wrong Answer");return;}
+    q = std::move(p);
+    if(!equal(q, stl)){puts("Wrong Answer");return;}
+    swap(q, r);
+    q.clear();
+    if(!equal(r, stl)){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test7(){
+    printf("test7: complexity                    ");
+    static overwrite_type q(1 << 16);
+    long long sum = 0;
+    for(int i = 0; i < 10000000; i++){
+        q.push_back(T(i));
+        if(i % 3 == 0) q.pop_front();
+    }
+    for(int i = 0; i < 10000000; i++) sum += q[rand() % q.size()].num();
+    if(sum < 0){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+//移动不申请内存：被移动过的 ring_deque 容量为 0，push 总是失败，赋值以后恢复
+static_assert(std::is_nothrow_move_constructible<reject_type>::value, "move constructor");
+static_assert(std::is_nothrow_move_assignable<overwrite_type>::value, "move assignment");
+static_assert(noexcept(std::declval<reject_type &>().swap(std::declval<reject_type &>())), "swap");
+template<class Q>
+bool moved_from(){
+    Q q(CAP);
+    for(int i=0;i<100;i++) q.push_back(T(i));
+    Q p(std::move(q));
+    if(p.size() != 100 || p.capacity() != 1024 || p.front() != T(0)) return false;
+    if(q.capacity() != 0 || !q.empty() || !q.full() || q.begin() != q.end()) return false;
+    int flag = 0;
+    try{
+        q.push_back(T(-1));
+    }catch(sjtu::container_is_full &){flag ++;}
+    try{
+        q.emplace_front(-1);
+    }catch(sjtu::container_is_full &){flag ++;}
+    if(flag != 2 || q.try_push_back(T(-1)) || q.try_push_front(T(-1)) || !q.empty()) return false;
+    Q c(q), d(1);
+    d = q;
+    if(c.capacity() != 0 || d.capacity() != 0) return false;
+    q = p;
+    if(q.size() != 100 || q.capacity() != 1024 || q.back() != T(99)) return false;
+    d = std::move(p);
+    q.swap(p);
+    p.push_back(T(100));
+    return d.size() == 100 && p.size() == 101 && q.capacity() == 0;
+}
+void test8(){
+    printf("test8: move without storage          ");
+    if(!moved_from<reject_type>() || !moved_from<overwrite_type>()){puts("Wrong Answer");return;}
+    //vector 扩容时逐个移动，不会申请新的存储空间
+    std::vector<reject_type> v;
+    for(int i=0;i<100;i++){
+        v.emplace_back(16);
+        v.back().push_back(T(i));
+    }
+    for(int i=0;i<100;i++) if(v[i].size() != 1 || v[i].front() != T(i) || v[i].capacity() != 16){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(time(NULL));
+    puts("test start:");
+    test1();//capacity
+    test2();//push & pop
+    test3();//reject
+    test4();//overwrite
+    test5();//at & [] & iterator
+    test6();//clear & copy & assignment
+    test7();//complexity
+    test8();//move without storage
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <string>
+#include "deque.hpp"
+#include "exceptions.hpp"
+#include "class-counting-allocator.hpp"
+
+
+/***************************/
+int N = 1000000;
+int OPS = 30000;
+/***************************/
+
+
+struct big{
+    char data[1024];
+};
+//默认的 block 大小约为 block_bytes 字节，元素很大时至少 min_chunk_size 个
+static_assert(sjtu::deque<int>::chunk_size == sjtu::block_bytes / sizeof(int), "int");
+static_assert(sjtu::deque<big>::chunk_size == sjtu::min_chunk_size, "big");
+static_assert(sjtu::deque<int, std::allocator<int>, sjtu::heap_pool, 100>::chunk_size == 100, "fixed");
+static_assert(sjtu::deque<int, std::allocator<int>, sjtu::heap_pool, sjtu::adaptive_chunk_size>::adaptive, "adaptive");
+
+template<class D, class S>
+bool equal(D &d, const S &s){
+    if(d.size() != s.size()) return false;
+    auto jt = s.begin();
+    for(auto it = d.begin(); it != d.end(); ++it, ++jt)
+        if(*it != *jt) return false;
+    for(size_t i=0;i<s.size();i+=37)
+        if(d[i] != s[i] || *(d.begin() + i) != s[i]) return false;
+    return true;
+}
+//自适应 block 大小下先增长再缩小，和 std::deque 比较
+template<class D>
+bool grow_shrink(){
+    D q;
+    std::deque<int> stl;
+    for(int round=0;round<2;round++){
+        for(int i=0;i<OPS;i++){
+            size_t p = rand() % (stl.size() + 1);
+            switch(rand() % 4){
+            case 0: q.push_back(i); stl.push_back(i); break;
+            case 1: q.push_front(i); stl.push_front(i); break;
+            default: q.insert(q.begin() + p, i); stl.insert(stl.begin() + p, i);
+            }
+        }
+        if(!equal(q, stl)) return false;
+        while(stl.size() > 100){
+            size_t p = rand() % stl.size();
+            switch(rand() % 4){
+            case 0: q.pop_back(); stl.pop_back(); break;
+            case 1: q.pop_front(); stl.pop_front(); break;
+            default: q.erase(q.begin() + p); stl.erase(stl.begin() + p);
+            }
+        }
+        if(!equal(q, stl)) return false;
+    }
+    return true;
+}
+//block 的个数：自适应时约为 sqrt(n)，固定为 min_chunk_size 时为 n / min_chunk_size
+template<class D>
+long long count_allocations(){
+    long long before = allocations;
+    D q;
+    for(int i=0;i<N;i++) q.push_back(i);
+    for(int i=0;i<N;i+=1000) if(q[i] != i) return -1;
+    return allocations - before;
+}
+void test1(){
+    printf("test1: adaptive grow & shrink        ");
+    if(!grow_shrink<sjtu::deque<int, std::allocator<int>, sjtu::heap_pool, sjtu::adaptive_chunk_size>>() ||
+       !grow_shrink<sjtu::deque<int, std::allocator<int>, sjtu::slab_pool, sjtu::adaptive_chunk_size>>() ||
+       !grow_shrink<sjtu::deque<int, std::allocator<int>, sjtu::cow_pool, sjtu::adaptive_chunk_size>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: adaptive block count          ");
+    long long adaptive = count_allocations<sjtu::deque<int, counting_allocator<int>, sjtu::heap_pool, sjtu::adaptive_chunk_size>>();
+    long long fixed = count_allocations<sjtu::deque<int, counting_allocator<int>, sjtu::heap_pool, sjtu::min_chunk_size>>();
+    fprintf(stderr, "allocations for %d push_back: adaptive %lld, fixed %d-element blocks %lld\n", N, adaptive, (int)sjtu::min_chunk_size, fixed);
+    //1e6 个元素时 block 容量增长到 1024，block 数为几千
+    if(adaptive < 0 || fixed < 0 || adaptive * 10 > fixed){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: random access                 ");
+    sjtu::deque<int, std::allocator<int>, sjtu::heap_pool, sjtu::adaptive_chunk_size> q;
+    for(int i=0;i<N;i++) q.push_back(i);
+    clock_t start = clock();
+    long long sum = 0;
+    for(int i=0;i<N;i++) sum += q[(long long)i * 7919 % N];
+    fprintf(stderr, "%d random reads: %.3fs\n", N, double(clock() - start) / CLOCKS_PER_SEC);
+    if(sum != (long long)N * (N - 1) / 2){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+//复用的 block 放不下时要换一块更大的存储空间，申请失败后 deque 仍然完整，可以继续使用和析构
+bool failed_assign(){
+    typedef sjtu::deque<int, counting_allocator<int>, sjtu::heap_pool, sjtu::adaptive_chunk_size> D;
+    D large;
+    //从前面插入，large 开头的 block 容量最大，比 small 的 block 都大
+    for(int i=N/10-1;i>=0;i--) large.push_front(i);
+    //依次让赋值过程中的每一次申请失败，直到赋值成功
+    for(long long k=0;;k++){
+        D small;
+        for(int i=0;i<1000;i++) small.push_back(i);
+        fail_at = allocations + k;
+        try{
+            small = large;
+        }catch(std::bad_alloc &){
+            size_t n = 0;
+            for(D::iterator it = small.begin(); it != small.end(); ++it) n++;
+            if(n != small.size()) return false;
+            small.push_back(-1);
+            if(small.back() != -1) return false;
+            continue;
+        }
+        fail_at = -1;
+        return k > 0 && small.size() == large.size() && small[N / 10 - 1] == N / 10 - 1 && small[0] == 0;
+    }
+}
+void test4(){
+    printf("test4: failed copy assignment        ");
+    if(!failed_assign()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(15);
+    puts("test start:");
+    test1();//adaptive grow & shrink
+    test2();//adaptive block count
+    test3();//random access
+    test4();//failed copy assignment
+}
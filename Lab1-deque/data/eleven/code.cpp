@@ -0,0 +1,157 @@
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <ctime>
+#include <deque>
+#include "deque.hpp"
+#include "exceptions.hpp"
+#include "class-counting-allocator.hpp"
+
+
+/***************************/
+int ROUNDS = 20000;
+int BIG = 200000;
+/***************************/
+
+
+template<class Pool>
+using Deque = sjtu::deque<std::string, counting_allocator<std::string>, Pool, 16>;
+
+template<class D>
+bool check(const D &d, int from, int to){
+    if((int)d.size() != to - from) return false;
+    int i = from;
+    for(auto it = d.cbegin(); it != d.cend(); ++it, ++i)
+        if(*it != std::to_string(i) || d[i - from] != *it) return false;
+    return true;
+}
+template<class Pool>
+bool splice_split(){
+    Deque<Pool> a, b;
+    for(int i=0;i<1000;i++) a.push_back(std::to_string(i));
+    for(int i=1000;i<3000;i++) b.push_back(std::to_string(i));
+    a.splice_back(std::move(b));
+    if(!check(a, 0, 3000) || !b.empty()) return false;
+    b.push_back("x");
+    b.pop_back();
+    for(int i=-1;i>=-500;i--) b.push_front(std::to_string(i));
+    Deque<Pool> c;
+    for(int i=-500;i<0;i++) c.push_back(std::to_string(i));
+    a.splice_front(std::move(c));
+    if(!check(a, -500, 3000) || !c.empty()) return false;
+    Deque<Pool> d = a.split_at(a.begin() + 1777);
+    if(!check(a, -500, 1277) || !check(d, 1277, 3000)) return false;
+    Deque<Pool> e = a.split_at(a.begin());
+    if(!a.empty() || !check(e, -500, 1277)) return false;
+    a.push_back("y");
+    Deque<Pool> f = d.split_at(d.end());
+    if(!f.empty() || !check(d, 1277, 3000)) return false;
+    e.splice_back(std::move(d));
+    e.splice_back(std::move(f));
+    return check(e, -500, 3000) && d.empty() && a.size() == 1 && a.front() == "y";
+}
+//生产者不断把一批元素 splice 给消费者，消费者取完以后再来下一批
+template<class Pool>
+bool splice_drain(){
+    long long before = live_bytes, mid = 0;
+    {
+        Deque<Pool> consumer, producer;
+        for(int r=0;r<ROUNDS;r++){
+            for(int i=0;i<100;i++) producer.push_back(std::to_string(i));
+            consumer.splice_back(std::move(producer));
+            int expect = 0;
+            while(!consumer.empty()){
+                if(consumer.front() != std::to_string(expect++)) return false;
+                consumer.pop_front();
+            }
+            if(r == ROUNDS / 10) mid = live_bytes;
+        }
+        if(live_bytes > mid * 2 + 4096) return false;
+    }
+    return live_bytes == before;
+}
+//两个分片来回 splice、split_at
+template<class Pool>
+bool shard(){
+    long long before = live_bytes, mid = 0;
+    {
+        Deque<Pool> a, b;
+        for(int i=0;i<300;i++) a.push_back(std::to_string(i));
+        for(int r=0;r<ROUNDS;r++){
+            for(int i=0;i<40;i++) b.push_back(std::to_string(300 + i));
+            a.splice_back(std::move(b));
+            for(int i=0;i<40;i++) a.pop_front();
+            b = a.split_at(a.begin() + a.size() / 2);
+            a.splice_back(std::move(b));
+            for(int i=0;i<40;i++) a.push_front(std::to_string(i));
+            for(int i=0;i<40;i++) a.pop_back();
+            if(a.size() != 300) return false;
+            if(r == ROUNDS / 10) mid = live_bytes;
+        }
+        if(live_bytes > mid * 2 + 4096) return false;
+    }
+    return live_bytes == before;
+}
+//把很多很短的 deque 接到一个很长的 deque 两端，每次只处理接进来的 block，和 std::deque 比较
+//接头处的标号和目录要保持正确：区间 erase 比较 block 的先后，随机访问和 iterator 相减用到目录
+bool splice_long(){
+    sjtu::deque<int, std::allocator<int>, sjtu::heap_pool, 64> q;
+    std::deque<int> stl;
+    for(int i=0;i<BIG;i++) q.push_back(i), stl.push_back(i);
+    clock_t start = clock();
+    for(int r=0;r<ROUNDS * 10;r++){
+        sjtu::deque<int, std::allocator<int>, sjtu::heap_pool, 64> part;
+        int k = rand() % 3 + 1;
+        for(int i=0;i<k;i++) part.push_back(-r);
+        if(r % 16 == 0){
+            q.splice_front(std::move(part));
+            for(int i=0;i<k;i++) stl.push_front(-r);
+        }else{
+            q.splice_back(std::move(part));
+            for(int i=0;i<k;i++) stl.push_back(-r);
+        }
+        size_t p = rand() % stl.size();
+        if(q[p] != stl[p] || (q.begin() + p) - q.begin() != (int)p) return false;
+        if(r % 1000 == 0){
+            size_t l = rand() % stl.size(), len = rand() % 200;
+            if(l + len > stl.size()) len = stl.size() - l;
+            q.erase(q.begin() + l, q.begin() + l + len);
+            stl.erase(stl.begin() + l, stl.begin() + l + len);
+        }
+    }
+    fprintf(stderr, "%d splices onto a deque of %d: %.3fs\n", ROUNDS * 10, BIG, double(clock() - start) / CLOCKS_PER_SEC);
+    if(q.size() != stl.size()) return false;
+    size_t i = 0;
+    for(auto it = q.cbegin(); it != q.cend(); ++it, ++i) if(*it != stl[i]) return false;
+    return true;
+}
+void test1(){
+    printf("test1: splice & split                ");
+    if(!splice_split<sjtu::heap_pool>() || !splice_split<sjtu::slab_pool>() || !splice_split<sjtu::cow_pool>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: repeated splice memory        ");
+    if(!splice_drain<sjtu::heap_pool>() || !splice_drain<sjtu::slab_pool>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: repeated split memory         ");
+    if(!shard<sjtu::heap_pool>() || !shard<sjtu::slab_pool>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test4(){
+    printf("test4: splice onto a long deque      ");
+    if(!splice_long()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(20);
+    puts("test start:");
+    test1();//splice & split
+    test2();//repeated splice memory
+    test3();//repeated split memory
+    test4();//splice onto a long deque
+}
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <string>
+#include "deque.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+bool need_to_check_throw = 1;
+int N = 3000;
+int BIG = 10000000;
+/***************************/
+
+
+template<class D, class S>
+bool equal(D &d, const S &s){
+    if(d.size() != s.size()) return false;
+    auto jt = s.begin();
+    for(auto it = d.begin(); it != d.end(); ++it, ++jt)
+        if(*it != *jt) return false;
+    for(size_t i=0;i<s.size();i+=37)
+        if(d[i] != s[i] || *(d.begin() + i) != s[i]) return false;
+    return true;
+}
+//随机删除一段（块内、跨很多块、前缀、后缀、空区间），和 std::deque 比较
+template<class D>
+bool range_erase(){
+    D q;
+    std::deque<std::string> stl;
+    for(int i=0;i<N;i++){
+        if(stl.size() < 2000){
+            int len = rand() % 5000;
+            for(int j=0;j<len;j++){
+                std::string v = std::to_string(i) + "-" + std::to_string(j);
+                q.push_back(v);
+                stl.push_back(v);
+            }
+        }
+        size_t p, k;
+        switch(i % 5){
+        case 0: p = 0; k = rand() % (stl.size() + 1); break;
+        case 1: k = rand() % (stl.size() + 1); p = stl.size() - k; break;
+        case 2: p = rand() % (stl.size() + 1); k = 0; break;
+        case 3: p = rand() % (stl.size() + 1); k = rand() % (stl.size() - p + 1) % 10; break;
+        default: p = rand() % (stl.size() + 1); k = rand() % (stl.size() - p + 1);
+        }
+        auto it = q.erase(q.begin() + p, q.begin() + (p + k));
+        auto jt = stl.erase(stl.begin() + p, stl.begin() + (p + k));
+        if(it - q.begin() != jt - stl.begin()) return false;
+        if(jt != stl.end() && *it != *jt) return false;
+        if(jt == stl.end() && it != q.end()) return false;
+        if(i % 200 == 0 && !equal(q, stl)) return false;
+        //删除以后接着在返回的位置插入
+        if(i % 7 == 0){
+            q.insert(it, "x");
+            stl.insert(jt, "x");
+        }
+    }
+    q.erase(q.begin(), q.end());
+    return q.empty() && q.begin() == q.end();
+}
+bool erase_throw(){
+    sjtu::deque<int> a, b;
+    for(int i=0;i<1000;i++) a.push_back(i), b.push_back(i);
+    bool ok = true;
+    try{
+        a.erase(a.begin() + 600, a.begin() + 500);
+        ok = false;
+    }catch(sjtu::invalid_iterator &){}
+    try{
+        a.erase(a.begin() + 5, a.begin() + 4);
+        ok = false;
+    }catch(sjtu::invalid_iterator &){}
+    try{
+        a.erase(b.begin(), b.begin() + 10);
+        ok = false;
+    }catch(sjtu::invalid_iterator &){}
+    try{
+        a.erase(a.begin(), b.end());
+        ok = false;
+    }catch(sjtu::invalid_iterator &){}
+    auto it = a.begin() + 700;
+    a.erase(a.begin() + 100, a.begin() + 200);
+    try{
+        a.erase(it, a.end());
+        ok = false;
+    }catch(sjtu::invalid_iterator &){}
+    return ok && a.size() == 900 && b.size() == 1000 && a[100] == 200;
+}
+void test1(){
+    printf("test1: range erase                   ");
+    if(!range_erase<sjtu::deque<std::string>>() || !range_erase<sjtu::deque<std::string, std::allocator<std::string>, sjtu::slab_pool, 8>>() ||
+       !range_erase<sjtu::deque<std::string, std::allocator<std::string>, sjtu::heap_pool, sjtu::adaptive_chunk_size>>() ||
+       !range_erase<sjtu::rope_deque<std::string, std::allocator<std::string>, sjtu::heap_pool, 8>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: throw                         ");
+    if(!need_to_check_throw){puts("Skip");return;}
+    if(!erase_throw()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: erase large ranges            ");
+    sjtu::deque<int> q;
+    for(int i=0;i<BIG;i++) q.push_back(i);
+    clock_t start = clock();
+    //去掉过期的前缀，再去掉中间的一大段
+    q.erase(q.begin(), q.begin() + BIG / 2);
+    q.erase(q.begin() + BIG / 8, q.begin() + BIG / 4);
+    double t = double(clock() - start) / CLOCKS_PER_SEC;
+    fprintf(stderr, "erase %d of %d ints: %.3fs\n", BIG / 2 + BIG / 8, BIG, t);
+    if((int)q.size() != BIG / 2 - BIG / 8 || q.front() != BIG / 2 || q[BIG / 8] != BIG / 2 + BIG / 4 || q.back() != BIG - 1){
+        puts("Wrong Answer");
+        return;
+    }
+    puts("Accept");
+}
+int main(){
+    srand(18);
+    puts("test start:");
+    test1();//range erase
+    test2();//throw
+    test3();//erase large ranges
+}
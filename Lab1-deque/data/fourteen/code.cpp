@@ -0,0 +1,180 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <list>
+#include <string>
+#include <vector>
+#include "deque.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+int N = 20000;
+int BIG = 10000000;
+/***************************/
+
+
+//复制到第 limit 次时抛出异常的元素
+int copies = 0, limit = -1;
+class T{
+private:
+    int x;
+public:
+    T(int x):x(x){}
+    T(const T &other):x(other.x){
+        if(++copies == limit) throw std::runtime_error("copy");
+    }
+    //移动不计数，deque 搬动已有元素时不会抛出异常
+    T(T &&other) noexcept :x(other.x){}
+    T &operator=(const T &other) = default;
+    T &operator=(T &&other) = default;
+    int num()const {return x;}
+};
+bool operator == (const T &a, const T &b){
+    return a.num() == b.num();
+}
+
+template<class D, class S>
+bool equal(const D &d, const S &s){
+    if(d.size() != s.size()) return false;
+    auto jt = s.begin();
+    for(auto it = d.cbegin(); it != d.cend(); ++it, ++jt)
+        if(!(*it == *jt)) return false;
+    for(size_t i=0;i<s.size();i+=97)
+        if(!(d[i] == s[i])) return false;
+    return true;
+}
+//随机位置插入一段、几个相同的元素、从链表（只能单向前进的 iterator 也可以）插入，和 std::deque 比较
+template<class D>
+bool range_insert(){
+    D q;
+    std::deque<T> stl;
+    for(int i=0;i<N;i++){
+        size_t p = rand() % (stl.size() + 1);
+        int len = rand() % 300;
+        std::vector<T> v;
+        for(int j=0;j<len;j++) v.push_back(T(i * 1000 + j));
+        auto it = q.begin() + p;
+        switch(i % 3){
+        case 0:
+            it = q.insert(it, v.begin(), v.end());
+            stl.insert(stl.begin() + p, v.begin(), v.end());
+            break;
+        case 1:
+            it = q.insert(it, size_t(len % 7), T(-i));
+            stl.insert(stl.begin() + p, size_t(len % 7), T(-i));
+            break;
+        default:
+            std::list<T> l(v.begin(), v.end());
+            it = q.insert(it, l.begin(), l.end());
+            stl.insert(stl.begin() + p, l.begin(), l.end());
+        }
+        if(it - q.begin() != (int)p) return false;
+        if(stl.size() > 30000){
+            size_t k = rand() % stl.size();
+            q.erase(q.begin() + k, q.end());
+            stl.erase(stl.begin() + k, stl.end());
+        }
+        if(i % 500 == 0 && !equal(q, stl)) return false;
+    }
+    return equal(q, stl);
+}
+template<class D>
+bool assign_append(){
+    D q;
+    std::deque<T> stl;
+    for(int i=0;i<200;i++){
+        std::vector<T> v;
+        int len = rand() % 2000;
+        for(int j=0;j<len;j++) v.push_back(T(rand()));
+        if(i % 4 == 0){
+            q.assign(v.begin(), v.end());
+            stl.assign(v.begin(), v.end());
+        }else if(i % 4 == 1){
+            q.assign(size_t(len), T(i));
+            stl.assign(size_t(len), T(i));
+        }else{
+            q.append(v.begin(), v.end());
+            stl.insert(stl.end(), v.begin(), v.end());
+        }
+        if(!equal(q, stl)) return false;
+    }
+    //插入自己的元素
+    q.insert(q.begin() + q.size() / 2, q.size() > 0 ? 3 : 0, q.size() > 0 ? q[q.size() / 2] : T(0));
+    stl.insert(stl.begin() + stl.size() / 2, stl.size() > 0 ? 3 : 0, stl.size() > 0 ? stl[stl.size() / 2] : T(0));
+    return equal(q, stl);
+}
+//复制抛出异常时已经插入的元素保留，deque 仍然完整可用
+template<class D>
+bool insert_throw(){
+    D q;
+    std::deque<T> stl;
+    for(int i=0;i<5000;i++) q.push_back(T(i)), stl.push_back(T(i));
+    for(int r=0;r<200;r++){
+        std::vector<T> v;
+        int len = 1 + rand() % 1000;
+        for(int j=0;j<len;j++) v.push_back(T(-j));
+        size_t p = rand() % (stl.size() + 1);
+        int ok = rand() % len;
+        copies = 0;
+        limit = ok + 1;
+        try{
+            if(r % 2) q.insert(q.begin() + p, v.begin(), v.end());
+            else q.append(v.begin(), v.end());
+            limit = -1;
+            return false;
+        }catch(std::runtime_error &){}
+        limit = -1;
+        if(r % 2) stl.insert(stl.begin() + p, v.begin(), v.begin() + ok);
+        else stl.insert(stl.end(), v.begin(), v.begin() + ok);
+        if(!equal(q, stl)) return false;
+        if(r % 10 == 0){
+            auto it = q.begin();
+            for(size_t i=0;i<stl.size();i++) ++it;
+            if(it != q.end()) return false;
+        }
+    }
+    return true;
+}
+void test1(){
+    printf("test1: range insert                  ");
+    if(!range_insert<sjtu::deque<T>>() || !range_insert<sjtu::deque<T, std::allocator<T>, sjtu::slab_pool, 16>>() ||
+       !range_insert<sjtu::deque<T, std::allocator<T>, sjtu::heap_pool, sjtu::adaptive_chunk_size>>() ||
+       !range_insert<sjtu::rope_deque<T, std::allocator<T>, sjtu::heap_pool, 16>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: assign & append               ");
+    if(!assign_append<sjtu::deque<T>>() || !assign_append<sjtu::deque<T, std::allocator<T>, sjtu::cow_pool, 16>>() ||
+       !assign_append<sjtu::rope_deque<T>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: exception during insert       ");
+    if(!insert_throw<sjtu::deque<T, std::allocator<T>, sjtu::heap_pool, 8>>() ||
+       !insert_throw<sjtu::deque<T, std::allocator<T>, sjtu::heap_pool, sjtu::adaptive_chunk_size>>() ||
+       !insert_throw<sjtu::rope_deque<T, std::allocator<T>, sjtu::heap_pool, 8>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test4(){
+    printf("test4: append 1e7 elements           ");
+    std::vector<int> v(BIG);
+    for(int i=0;i<BIG;i++) v[i] = i;
+    clock_t start = clock();
+    sjtu::deque<int> q;
+    q.append(v.begin(), v.end());
+    double t = double(clock() - start) / CLOCKS_PER_SEC;
+    fprintf(stderr, "append %d ints: %.3fs\n", BIG, t);
+    if((int)q.size() != BIG || q[BIG / 2] != BIG / 2 || q.back() != BIG - 1){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(17);
+    puts("test start:");
+    test1();//range insert
+    test2();//assign & append
+    test3();//exception during insert
+    test4();//append 1e7 elements
+}
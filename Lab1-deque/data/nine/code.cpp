@@ -0,0 +1,68 @@
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "spsc_deque.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+int N = 10000000;
+/***************************/
+
+
+class T{
+private:
+    int x;
+public:
+    T():x(0){}
+    T(int x):x(x){}
+    int num()const {return x;}
+};
+void test1(){
+    printf("test1: push & pop                    ");
+    sjtu::spsc_deque<T> q;
+    int flag = 0;
+    try{
+        q.front();
+    }catch(sjtu::container_is_empty &){flag ++;}
+    try{
+        q.pop_front();
+    }catch(sjtu::container_is_empty &){flag ++;}
+    T t;
+    if(flag != 2 || q.try_pop_front(t) || !q.empty()){puts("Wrong Answer");return;}
+    for(int i=0;i<100000;i++){
+        q.push_back(T(i));
+        if(i % 3 == 0){
+            if(!q.try_pop_front(t) || t.num() != i / 3 * 2){puts("Wrong Answer");return;}
+        }else if(i % 3 == 1){
+            if(q.front().num() != i / 3 * 2 + 1){puts("Wrong Answer");return;}
+            q.pop_front();
+        }
+    }
+    if(q.size() != 100000 / 3){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: two threads                   ");
+    static sjtu::spsc_deque<T> q;
+    std::thread producer([]{
+        for(int i=0;i<N;i++) q.push_back(T(i));
+    });
+    bool ok = 1;
+    T t;
+    for(int i=0;i<N;){
+        if(!q.try_pop_front(t)) continue;
+        if(t.num() != i) ok = 0;
+        i++;
+    }
+    producer.join();
+    if(!ok || !q.empty()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    puts("test start:");
+    test1();//push & pop
+    test2();//two threads
+}
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <memory_resource>
+#include "deque.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+int REQUESTS = 2000;
+int N = 10000;
+/***************************/
+
+
+//记录申请、释放次数和还没有释放的字节数，内存来自 upstream
+class counting_resource : public std::pmr::memory_resource{
+public:
+    long long allocations = 0, live = 0;
+    std::pmr::memory_resource *upstream;
+    explicit counting_resource(std::pmr::memory_resource *up = std::pmr::new_delete_resource()):upstream(up){}
+private:
+    void *do_allocate(size_t bytes, size_t align) override {
+        allocations++;
+        live += bytes;
+        return upstream->allocate(bytes, align);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t align) override {
+        live -= bytes;
+        upstream->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+template<class D>
+bool check(const D &d, int from, int to){
+    if((int)d.size() != to - from) return false;
+    int i = from;
+    for(auto it = d.cbegin(); it != d.cend(); ++it, ++i)
+        if(*it != i || d[i - from] != i) return false;
+    return true;
+}
+//所有内存都来自给定的 resource，析构后全部归还，默认 resource 一次也没有用到
+template<class Pool>
+bool from_resource(){
+    counting_resource res, dflt;
+    std::pmr::memory_resource *old = std::pmr::set_default_resource(&dflt);
+    bool ok = true;
+    {
+        sjtu::pmr::deque<int, Pool> q(&res);
+        for(int i=0;i<N;i++) q.push_back(i);
+        for(int i=0;i<N/2;i++) q.pop_front();
+        q.insert(q.begin() + 100, 3, -1);
+        q.erase(q.begin() + 100, q.begin() + 103);
+        ok = check(q, N / 2, N) && res.allocations > 0 && res.live > 0 && q.get_allocator().resource() == &res;
+    }
+    ok = ok && res.live == 0 && dflt.allocations == 0;
+    std::pmr::set_default_resource(old);
+    return ok;
+}
+//polymorphic_allocator 不随复制、移动、交换传播
+bool no_propagation(){
+    counting_resource r1, r2;
+    sjtu::pmr::deque<int> a(&r1), b(&r2);
+    for(int i=0;i<N;i++) a.push_back(i);
+    for(int i=0;i<10;i++) b.push_back(-i);
+    sjtu::pmr::deque<int> c(a);
+    if(c.get_allocator().resource() != std::pmr::get_default_resource() || !check(c, 0, N)) return false;
+    long long before = r1.allocations;
+    //resource 不同，只能逐个移动元素，b 的内存仍然来自 r2
+    b = std::move(a);
+    if(b.get_allocator().resource() != &r2 || !check(b, 0, N) || !a.empty() || r1.allocations != before) return false;
+    b = c;
+    if(b.get_allocator().resource() != &r2 || !check(b, 0, N)) return false;
+    sjtu::pmr::deque<int> d(std::move(b));
+    if(d.get_allocator().resource() != &r2 || !check(d, 0, N) || !b.empty()) return false;
+    d.splice_back(std::move(c));
+    return d.size() == (size_t)N * 2 && d[N] == 0 && c.empty();
+}
+//每个请求在自己的 arena 中建很多短命的 deque，arena 用完一起丢掉
+bool arena(){
+    static char buffer[1 << 20];
+    counting_resource heap;
+    for(int r=0;r<REQUESTS;r++){
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), &heap);
+        long long sum = 0;
+        for(int k=0;k<8;k++){
+            sjtu::pmr::deque<int, sjtu::heap_pool, 64> q(&arena);
+            for(int i=0;i<200;i++){
+                q.push_back(i);
+                q.push_front(-i);
+            }
+            while(q.size() > 10) q.pop_back();
+            for(auto it = q.begin(); it != q.end(); ++it) sum += *it;
+        }
+        if(sum != -8LL * (199 + 198 + 197 + 196 + 195 + 194 + 193 + 192 + 191 + 190)) return false;
+    }
+    //1MB 的 buffer 足够，从来没有向 heap 申请
+    return heap.allocations == 0;
+}
+void test1(){
+    printf("test1: memory from the resource      ");
+    if(!from_resource<sjtu::heap_pool>() || !from_resource<sjtu::slab_pool>() || !from_resource<sjtu::cow_pool>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: allocator propagation         ");
+    if(!no_propagation()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: per-request arena             ");
+    clock_t start = clock();
+    if(!arena()){puts("Wrong Answer");return;}
+    fprintf(stderr, "%d requests: %.3fs\n", REQUESTS, double(clock() - start) / CLOCKS_PER_SEC);
+    puts("Accept");
+}
+int main(){
+    puts("test start:");
+    test1();//memory from the resource
+    test2();//allocator propagation
+    test3();//per-request arena
+}
@@ -0,0 +1,206 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <type_traits>
+#include "deque.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+bool need_to_check_throw = 1;
+int N = 300000;
+int OPS = 20000;
+/***************************/
+
+
+//只引入 deque.hpp 就可以用 basic_deque 选择实现
+static_assert(std::is_same<sjtu::basic_deque<int>, sjtu::deque<int>>::value, "list_engine is the default");
+static_assert(std::is_same<sjtu::basic_deque<int, sjtu::list_engine>, sjtu::deque<int>>::value, "list_engine");
+static_assert(std::is_same<sjtu::basic_deque<int, sjtu::tree_engine>, sjtu::rope_deque<int>>::value, "tree_engine");
+
+template<class Pool>
+using Rope = sjtu::basic_deque<std::string, sjtu::tree_engine, std::allocator<std::string>, Pool, 16>;
+
+template<class D>
+bool check(const D &d, int from, int to){
+    if((int)d.size() != to - from) return false;
+    int i = from;
+    for(auto it = d.cbegin(); it != d.cend(); ++it, ++i)
+        if(*it != std::to_string(i) || d[i - from] != *it) return false;
+    i = to;
+    for(auto it = d.cend(); it != d.cbegin();)
+        if(*--it != std::to_string(--i)) return false;
+    return true;
+}
+//在一个很长的 rope_deque 中间随机插入删除，和 std::deque 比较
+template<class Q>
+bool middle(){
+    Q q;
+    std::deque<long long> stl;
+    for(int i=0;i<N;i++){
+        q.push_back(i);
+        stl.push_back(i);
+    }
+    for(int i=0;i<OPS;i++){
+        size_t p = rand() % (stl.size() + 1);
+        if(i % 3 != 0){
+            q.insert(q.begin() + p, -i);
+            stl.insert(stl.begin() + p, -i);
+        }else if(p < stl.size()){
+            auto it = q.erase(q.begin() + p);
+            stl.erase(stl.begin() + p);
+            if(it - q.begin() != (long long)p) return false;
+        }
+        size_t k = rand() % stl.size();
+        if(q[k] != stl[k] || q.at(k) != stl[k] || *(q.cbegin() + k) != stl[k]) return false;
+        if((q.begin() + k) - q.begin() != (long long)k) return false;
+    }
+    if(q.size() != stl.size()) return false;
+    auto it = stl.begin();
+    for(auto jt = q.begin(); jt != q.end(); ++jt, ++it)
+        if(*jt != *it) return false;
+    return true;
+}
+template<class Pool>
+bool splice_split(){
+    Rope<Pool> a, b;
+    for(int i=0;i<1000;i++) a.push_back(std::to_string(i));
+    for(int i=1000;i<3000;i++) b.push_back(std::to_string(i));
+    a.splice_back(std::move(b));
+    if(!check(a, 0, 3000) || !b.empty()) return false;
+    b.push_back("x");
+    b.pop_back();
+    Rope<Pool> c;
+    for(int i=-500;i<0;i++) c.push_back(std::to_string(i));
+    a.splice_front(std::move(c));
+    if(!check(a, -500, 3000) || !c.empty()) return false;
+    //split_at 之后前面部分的 iterator 仍然有效
+    auto keep = a.begin() + 100;
+    Rope<Pool> d = a.split_at(a.begin() + 1777);
+    if(!check(a, -500, 1277) || !check(d, 1277, 3000)) return false;
+    if(*keep != "-400" || keep - a.begin() != 100) return false;
+    Rope<Pool> e = a.split_at(a.begin());
+    if(!a.empty() || !check(e, -500, 1277)) return false;
+    a.push_back("y");
+    Rope<Pool> f = d.split_at(d.end());
+    if(!f.empty() || !check(d, 1277, 3000)) return false;
+    //切成很多小段再按顺序接回去
+    Rope<Pool> parts[10];
+    for(int i=9;i>0;i--) parts[i] = d.split_at(d.begin() + i * 172);
+    for(int i=1;i<10;i++) d.splice_back(std::move(parts[i]));
+    if(!check(d, 1277, 3000)) return false;
+    e.splice_back(std::move(d));
+    e.splice_back(std::move(f));
+    if(!check(e, -500, 3000) || !d.empty()) return false;
+    d.push_back("z");
+    return a.size() == 1 && a.front() == "y" && d.front() == "z";
+}
+//把一个很长的 rope_deque 反复从中间切开再接回去
+bool split_many(){
+    sjtu::rope_deque<int> q;
+    for(int i=0;i<N;i++) q.push_back(i);
+    for(int r=0;r<OPS;r++){
+        size_t p = rand() % (q.size() + 1);
+        sjtu::rope_deque<int> tail = q.split_at(q.begin() + p);
+        if(q.size() != p || tail.size() != (size_t)N - p) return false;
+        if(p > 0 && q.back() != (int)p - 1) return false;
+        if(p < (size_t)N && tail.front() != (int)p) return false;
+        q.splice_back(std::move(tail));
+        if(!tail.empty()) return false;
+    }
+    for(int i=0;i<N;i++) if(q[i] != i) return false;
+    return true;
+}
+//自适应 block 大小：两端 push、中间插入、复制到 block 更小的 rope_deque 上、remove_if，和 std::deque 比较
+//rope_deque 没有 finger，统计总是 0
+bool adaptive(){
+    typedef sjtu::rope_deque<std::string, std::allocator<std::string>, sjtu::heap_pool, sjtu::adaptive_chunk_size> A;
+    A q, small;
+    std::deque<std::string> stl;
+    for(int i=0;i<50;i++) small.push_back(std::to_string(i));
+    for(int i=0;i<N / 10;i++){
+        if(i % 2 == 0) q.push_back(std::to_string(i)), stl.push_back(std::to_string(i));
+        else q.push_front(std::to_string(i)), stl.push_front(std::to_string(i));
+    }
+    for(int i=0;i<OPS / 10;i++){
+        size_t p = rand() % (stl.size() + 1);
+        q.insert(q.begin() + p, std::to_string(-i));
+        stl.insert(stl.begin() + p, std::to_string(-i));
+        p = rand() % stl.size();
+        if(q[p] != stl[p]) return false;
+    }
+    small = q;
+    A copy(small);
+    auto pred = [](const std::string &x){ return x.size() % 3 == 0; };
+    copy.remove_if(pred);
+    std::deque<std::string> rest;
+    for(auto &x : stl) if(!pred(x)) rest.push_back(x);
+    if(small.size() != stl.size() || copy.size() != rest.size()) return false;
+    for(size_t i=0;i<stl.size();i++) if(small[i] != stl[i] || q.at(i) != stl[i]) return false;
+    size_t i = 0;
+    for(auto it = copy.cbegin(); it != copy.cend(); ++it, ++i) if(*it != rest[i]) return false;
+    while(!q.empty()){
+        if(q.back() != stl.back()) return false;
+        q.pop_back();
+        stl.pop_back();
+        if(!q.empty()) q.pop_front(), stl.pop_front();
+    }
+    q.reset_finger_stats();
+    return q.finger_hits() == 0 && q.finger_misses() == 0 && small.finger_hits() == 0;
+}
+void test1(){
+    printf("test1: insert & erase in the middle  ");
+    if(!middle<sjtu::basic_deque<long long, sjtu::tree_engine>>() ||
+       !middle<sjtu::basic_deque<long long, sjtu::tree_engine, std::allocator<long long>, sjtu::heap_pool, sjtu::adaptive_chunk_size>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: splice & split                ");
+    if(!splice_split<sjtu::heap_pool>() || !splice_split<sjtu::slab_pool>() || !splice_split<sjtu::cow_pool>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: repeated split                ");
+    clock_t start = clock();
+    if(!split_many()){puts("Wrong Answer");return;}
+    fprintf(stderr, "split_at & splice_back x %d: %.3fs\n", OPS, double(clock() - start) / CLOCKS_PER_SEC);
+    puts("Accept");
+}
+void test4(){
+    printf("test4: throw                         ");
+    if(!need_to_check_throw){puts("Skip");return;}
+    sjtu::rope_deque<int> a, b;
+    for(int i=0;i<100;i++) a.push_back(i), b.push_back(i);
+    bool ok = true;
+    try{
+        a.split_at(b.begin() + 10);
+        ok = false;
+    }catch(...){}
+    try{
+        a.insert(b.begin(), 1);
+        ok = false;
+    }catch(...){}
+    try{
+        a.at(100);
+        ok = false;
+    }catch(...){}
+    if(!ok || a.size() != 100 || b.size() != 100){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test5(){
+    printf("test5: adaptive block size           ");
+    if(!adaptive()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(1234);
+    puts("test start:");
+    test1();//insert & erase in the middle
+    test2();//splice & split
+    test3();//repeated split
+    test4();//throw
+    test5();//adaptive block size
+}
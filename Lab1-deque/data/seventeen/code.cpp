@@ -0,0 +1,131 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <vector>
+#include "deque.hpp"
+#include "exceptions.hpp"
+#include "class-counting-allocator.hpp"
+
+
+/***************************/
+int N = 100000;
+int BIG = 5000000;
+/***************************/
+
+
+typedef sjtu::deque<std::string, counting_allocator<std::string>, sjtu::cow_pool, 16> Deque;
+
+template<class D, class S>
+bool equal(const D &d, const S &s){
+    if(d.size() != s.size()) return false;
+    auto jt = s.begin();
+    for(auto it = d.cbegin(); it != d.cend(); ++it, ++jt)
+        if(*it != *jt) return false;
+    for(size_t i=0;i<s.size();i+=37)
+        if(d[i] != s[i]) return false;
+    return true;
+}
+//快照之后双方各自随意修改，互不影响
+bool isolation(){
+    Deque q;
+    std::deque<std::string> stl;
+    for(int i=0;i<3000;i++){
+        q.push_back(std::to_string(i));
+        stl.push_back(std::to_string(i));
+    }
+    std::vector<Deque> snaps;
+    std::vector<std::deque<std::string>> expect;
+    for(int i=0;i<N;i++){
+        if(i % 5000 == 0){
+            if(snaps.size() < 6){
+                snaps.push_back(q);
+                expect.push_back(stl);
+            }else{
+                size_t k = rand() % snaps.size();
+                snaps[k] = q;
+                expect[k] = stl;
+            }
+        }
+        //一部分操作改快照，一部分改原来的 deque
+        bool own = snaps.empty() || rand() % 4 != 0;
+        size_t k = snaps.empty() ? 0 : rand() % snaps.size();
+        Deque &d = own ? q : snaps[k];
+        std::deque<std::string> &s = own ? stl : expect[k];
+        std::string v = "v" + std::to_string(i);
+        size_t p = rand() % (s.size() + 1);
+        switch(rand() % 8){
+        case 0: d.push_back(v); s.push_back(v); break;
+        case 1: d.push_front(v); s.push_front(v); break;
+        case 2: if(!s.empty()){ d.pop_back(); s.pop_back(); } break;
+        case 3: if(!s.empty()){ d.pop_front(); s.pop_front(); } break;
+        case 4: d.insert(d.begin() + p, v); s.insert(s.begin() + p, v); break;
+        case 5: if(p < s.size()){ d.erase(d.begin() + p); s.erase(s.begin() + p); } break;
+        case 6: if(p < s.size()){ d[p] = v; s[p] = v; } break;
+        default: if(p < s.size()){ *(d.begin() + p) += "w"; s[p] += "w"; } break;
+        }
+    }
+    if(!equal(q, stl)) return false;
+    for(size_t i=0;i<snaps.size();i++) if(!equal(snaps[i], expect[i])) return false;
+    //remove_if 和 clear 也只改自己
+    Deque copy = q;
+    copy.remove_if([](const std::string &x){ return x.size() % 2 == 0; });
+    q.clear();
+    return equal(snaps[0], expect[0]) && q.empty() && copy.size() <= stl.size();
+}
+//快照只共享 block，不复制元素；释放顺序任意，内存全部归还
+bool snapshot_memory(){
+    long long before = live_bytes;
+    {
+        Deque q;
+        for(int i=0;i<N;i++) q.push_back(std::string(40, 'a' + i % 26));
+        long long full = live_bytes - before;
+        Deque snap(q);
+        long long shared = live_bytes - before - full;
+        //每个 block 16 个元素，快照只需要 block 的结点
+        if(shared * 4 > full) return false;
+        const std::string &ref = snap[N / 2];
+        q[N / 2] = "changed";
+        if(ref != std::string(40, 'a' + (N / 2) % 26) || snap[N / 2] != ref) return false;
+        Deque snap2 = snap;
+        q.clear();
+        snap.pop_back();
+        if(snap2.size() != (size_t)N || snap.size() != (size_t)N - 1) return false;
+    }
+    return live_bytes == before;
+}
+void test1(){
+    printf("test1: snapshot isolation            ");
+    if(!isolation()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: snapshot memory               ");
+    if(!snapshot_memory()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: snapshot cost                 ");
+    sjtu::deque<long long, std::allocator<long long>, sjtu::cow_pool> q;
+    sjtu::deque<long long> plain;
+    for(int i=0;i<BIG;i++) q.push_back(i), plain.push_back(i);
+    clock_t start = clock();
+    auto snap = q;
+    clock_t mid = clock();
+    auto deep = plain;
+    clock_t end = clock();
+    fprintf(stderr, "copy of %d elements: snapshot %.3fs, deep copy %.3fs\n", BIG,
+            double(mid - start) / CLOCKS_PER_SEC, double(end - mid) / CLOCKS_PER_SEC);
+    q[0] = -1;
+    if(snap[0] != 0 || snap.size() != q.size() || deep.back() != BIG - 1){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(22);
+    puts("test start:");
+    test1();//snapshot isolation
+    test2();//snapshot memory
+    test3();//snapshot cost
+}
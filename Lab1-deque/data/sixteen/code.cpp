@@ -0,0 +1,133 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <vector>
+#include "deque.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+int N = 200000;
+int BIG = 10000000;
+/***************************/
+
+
+template<class D, class S>
+bool equal(D &d, const S &s){
+    if(d.size() != s.size()) return false;
+    auto jt = s.begin();
+    for(auto it = d.begin(); it != d.end(); ++it, ++jt)
+        if(*it != *jt) return false;
+    for(size_t i=0;i<s.size();i+=37)
+        if(d[i] != s[i] || *(d.begin() + i) != s[i]) return false;
+    auto it = d.end();
+    for(size_t i=s.size();i>0;i--)
+        if(*--it != s[i - 1]) return false;
+    return true;
+}
+template<class S, class Pred>
+size_t reference(S &s, Pred pred){
+    S keep;
+    for(auto &x : s) if(!pred(x)) keep.push_back(x);
+    size_t removed = s.size() - keep.size();
+    s.swap(keep);
+    return removed;
+}
+//不删、全删、隔一个删一个、随机删，删完以后继续插入删除
+template<class D>
+bool filter(){
+    D q;
+    std::deque<std::string> stl;
+    for(int i=0;i<N;i++){
+        q.push_back(std::to_string(i));
+        stl.push_back(std::to_string(i));
+    }
+    auto none = [](const std::string &){ return false; };
+    auto odd = [](const std::string &x){ return (x.back() - '0') % 2 == 1; };
+    auto rare = [](const std::string &x){ return x.size() > 2 && x[x.size() - 3] == '7'; };
+    auto most = [](const std::string &x){ return x.back() != '3'; };
+    if(q.remove_if(none) != 0 || !equal(q, stl)) return false;
+    if(erase_if(q, odd) != reference(stl, odd) || !equal(q, stl)) return false;
+    if(q.remove_if(rare) != reference(stl, rare) || !equal(q, stl)) return false;
+    if(erase_if(q, most) != reference(stl, most) || !equal(q, stl)) return false;
+    for(int i=0;i<1000;i++){
+        size_t p = rand() % (stl.size() + 1);
+        q.insert(q.begin() + p, "x");
+        stl.insert(stl.begin() + p, "x");
+        if(i % 3 == 0 && !stl.empty()){
+            p = rand() % stl.size();
+            q.erase(q.begin() + p);
+            stl.erase(stl.begin() + p);
+        }
+    }
+    if(!equal(q, stl)) return false;
+    if(q.remove_if([](const std::string &){ return true; }) != stl.size() || !q.empty()) return false;
+    q.push_back("y");
+    return q.size() == 1 && q[0] == "y";
+}
+//谓词抛出异常时已经判断过的元素照常删除，其余的保留，顺序不变
+template<class D>
+bool pred_throw(){
+    for(int r=0;r<50;r++){
+        D q;
+        std::deque<std::string> stl;
+        int n = 1 + rand() % 5000;
+        for(int i=0;i<n;i++){
+            q.push_back(std::to_string(i));
+            stl.push_back(std::to_string(i));
+        }
+        int calls = 0, limit = 1 + rand() % n;
+        auto pred = [&](const std::string &x){
+            if(++calls == limit) throw std::runtime_error("pred");
+            return x.back() != '5';
+        };
+        try{
+            q.remove_if(pred);
+            return false;
+        }catch(std::runtime_error &){}
+        std::deque<std::string> keep;
+        for(int i=0;i<n;i++) if(i >= limit - 1 || stl[i].back() == '5') keep.push_back(stl[i]);
+        if(!equal(q, keep)) return false;
+        q.push_front("a");
+        keep.push_front("a");
+        if(!equal(q, keep)) return false;
+    }
+    return true;
+}
+void test1(){
+    printf("test1: remove_if & erase_if          ");
+    if(!filter<sjtu::deque<std::string>>() || !filter<sjtu::deque<std::string, std::allocator<std::string>, sjtu::slab_pool, 8>>() ||
+       !filter<sjtu::deque<std::string, std::allocator<std::string>, sjtu::heap_pool, sjtu::adaptive_chunk_size>>() ||
+       !filter<sjtu::rope_deque<std::string, std::allocator<std::string>, sjtu::heap_pool, 8>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: predicate throws              ");
+    if(!pred_throw<sjtu::deque<std::string, std::allocator<std::string>, sjtu::heap_pool, 8>>() ||
+       !pred_throw<sjtu::rope_deque<std::string, std::allocator<std::string>, sjtu::heap_pool, 8>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: filter 1e7 elements           ");
+    sjtu::deque<int> q;
+    for(int i=0;i<BIG;i++) q.push_back(i);
+    clock_t start = clock();
+    size_t removed = erase_if(q, [](int x){ return x % 10 != 0; });
+    double t = double(clock() - start) / CLOCKS_PER_SEC;
+    fprintf(stderr, "erase_if on %d ints: %.3fs\n", BIG, t);
+    if((int)removed != BIG - BIG / 10 || (int)q.size() != BIG / 10 || q[12345] != 123450 || q.back() != BIG - 10){
+        puts("Wrong Answer");
+        return;
+    }
+    puts("Accept");
+}
+int main(){
+    srand(19);
+    puts("test start:");
+    test1();//remove_if & erase_if
+    test2();//predicate throws
+    test3();//filter 1e7 elements
+}
@@ -0,0 +1,153 @@
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "steal_deque.hpp"
+#include "task_pool.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+int N = 1000000;
+int THIEVES = 3;
+int FIB = 38;
+/***************************/
+
+
+double now(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+void test1(){
+    printf("test1: push & pop & steal            ");
+    sjtu::steal_deque<int> q(4);
+    int t;
+    if(q.try_pop_back(t) || q.try_steal(t) || !q.empty()){puts("Wrong Answer");return;}
+    for(int i=0;i<N;i++) q.push_back(i);
+    if(q.size() != (size_t)N || q.capacity() < (size_t)N){puts("Wrong Answer");return;}
+    for(int i=0;i<10;i++){
+        if(!q.try_steal(t) || t != i){puts("Wrong Answer");return;}
+    }
+    for(int i=N-1;i>=10;i--){
+        if(!q.try_pop_back(t) || t != i){puts("Wrong Answer");return;}
+    }
+    if(q.try_pop_back(t) || !q.empty()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: concurrent steal              ");
+    //拥有者放入 0..N-1 并随时取回，thief 同时偷，每个数恰好被取走一次
+    sjtu::steal_deque<int> q;
+    std::vector<char> taken(N, 0);
+    std::atomic<bool> done(false);
+    std::atomic<int> bad(0);
+    std::vector<std::thread> thieves;
+    for(int k=0;k<THIEVES;k++) thieves.emplace_back([&]{
+        int t;
+        while(!done.load() || !q.empty()){
+            if(q.try_steal(t)){
+                if(taken[t]++) bad++;
+            }else std::this_thread::yield();
+        }
+    });
+    int t;
+    for(int i=0;i<N;i++){
+        q.push_back(i);
+        if(i % 3 == 0 && q.try_pop_back(t)){
+            if(taken[t]++) bad++;
+        }
+    }
+    while(q.try_pop_back(t)){
+        if(taken[t]++) bad++;
+    }
+    done = true;
+    for(size_t k=0;k<thieves.size();k++) thieves[k].join();
+    for(int i=0;i<N;i++) if(taken[i] != 1) bad++;
+    if(bad){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+long long fib_seq(int n){
+    return n < 2 ? n : fib_seq(n - 1) + fib_seq(n - 2);
+}
+long long fib(sjtu::task_pool &pool, int n){
+    if(n < 20) return fib_seq(n);
+    long long a = 0, b = 0;
+    sjtu::task_group g(pool);
+    g.spawn([&]{ a = fib(pool, n - 1); });
+    b = fib(pool, n - 2);
+    g.wait();
+    return a + b;
+}
+void test3(){
+    printf("test3: fork-join                     ");
+    sjtu::task_pool pool;
+    long long expect = fib_seq(25);
+    for(int i=0;i<20;i++){
+        if(fib(pool, 25) != expect){puts("Wrong Answer");return;}
+    }
+    //外部线程提交，任务中抛出的异常在 wait 中重新抛出
+    sjtu::task_group g(pool);
+    std::atomic<int> count(0);
+    for(int i=0;i<1000;i++) g.spawn([&]{ count++; });
+    //放不下 task 内部空间的可调用对象
+    std::vector<int> big(100, 1);
+    long long pad[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    for(int i=0;i<100;i++) g.spawn([&count, big, pad]{ count += big[99] * (int)pad[7]; });
+    g.spawn([]{ throw sjtu::container_is_empty(); });
+    bool flag = 0;
+    try{
+        g.wait();
+    }catch(sjtu::container_is_empty &){flag = 1;}
+    if(!flag || count != 1800){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+//三次中最快的一次，减少机器负载带来的波动
+double fib_time(size_t workers, long long expect){
+    sjtu::task_pool pool(workers);
+    double best = -1;
+    for(int i=0;i<3;i++){
+        long long result = 0;
+        double t0 = now();
+        pool.run([&]{ result = fib(pool, FIB); });
+        double t1 = now();
+        if(result != expect) return -1;
+        if(best < 0 || t1 - t0 < best) best = t1 - t0;
+    }
+    return best;
+}
+void test4(){
+    printf("test4: complexity                    ");
+    //一个工作线程时调度的开销不超过顺序执行的两倍；有 P 个硬件线程时用 P 个工作线程，
+    //至少快 min(P, 4)/2 倍：只限制要求的加速比，不限制线程数
+    long long expect = 0;
+    double seq = -1;
+    for(int i=0;i<3;i++){
+        double t0 = now();
+        expect = fib_seq(FIB);
+        double t1 = now();
+        if(seq < 0 || t1 - t0 < seq) seq = t1 - t0;
+    }
+    size_t threads = std::thread::hardware_concurrency();
+    double need = (threads > 4 ? 4 : threads) / 2.0;
+    double one = fib_time(1, expect);
+    if(one < 0 || one > 2 * seq){puts("Wrong Answer");return;}
+    fprintf(stderr, "fib(%d): sequential %.3fs, 1 worker %.3fs", FIB, seq, one);
+    if(threads >= 2){
+        double many = fib_time(threads, expect);
+        if(many < 0){puts("Wrong Answer");return;}
+        fprintf(stderr, ", %zu workers %.3fs, speedup %.2f", threads, many, one / many);
+        if(one / many < need){fputc('\n', stderr);puts("Wrong Answer");return;}
+    }
+    fputc('\n', stderr);
+    puts("Accept");
+}
+int main(){
+    puts("test start:");
+    test1();//push & pop & steal
+    test2();//concurrent steal
+    test3();//fork-join
+    test4();//complexity
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "deque.hpp"
+#include "exceptions.hpp"
+#include "class-counting-allocator.hpp"
+
+
+/***************************/
+int N = 10000;
+/***************************/
+
+
+typedef sjtu::deque<std::string, counting_allocator<std::string>> Deque;
+typedef sjtu::rope_deque<std::string, counting_allocator<std::string>> Rope;
+static_assert(std::is_nothrow_move_constructible<Deque>::value && std::is_nothrow_move_assignable<Deque>::value, "deque");
+static_assert(std::is_nothrow_move_constructible<Rope>::value && std::is_nothrow_move_assignable<Rope>::value, "rope_deque");
+static_assert(noexcept(std::declval<Deque &>().swap(std::declval<Deque &>())), "deque swap");
+static_assert(noexcept(std::declval<Rope &>().swap(std::declval<Rope &>())), "rope_deque swap");
+
+template<class D>
+bool check(const D &d, int from, int to){
+    if((int)d.size() != to - from) return false;
+    int i = from;
+    for(auto it = d.cbegin(); it != d.cend(); ++it, ++i)
+        if(*it != std::to_string(i)) return false;
+    return true;
+}
+//移动构造不申请内存，被移动过的容器不占用内存，之后仍然可以正常使用
+template<class D>
+bool moved_from(){
+    long long before = live_bytes;
+    D a;
+    for(int i=0;i<N;i++) a.push_back(std::to_string(i));
+    long long count = allocations;
+    {
+        D b(std::move(a));
+        if(allocations != count || !check(b, 0, N)) return false;
+        if(!a.empty() || a.size() != 0 || a.begin() != a.end() || a.cbegin() != a.cend() || a.end() - a.begin() != 0) return false;
+        try{
+            a.pop_front();
+            return false;
+        }catch(sjtu::container_is_empty &){}
+        try{
+            a.at(0);
+            return false;
+        }catch(sjtu::index_out_of_bound &){}
+        a.clear();
+        a.erase(a.begin(), a.end());
+        if(a.remove_if([](const std::string &){ return true; }) != 0) return false;
+        D c(a);
+        if(!c.empty()) return false;
+    }
+    if(live_bytes != before) return false;
+    D e = a.split_at(a.end());
+    if(!e.empty()) return false;
+    a.insert(a.end(), "1");
+    a.push_front("0");
+    a.push_back("2");
+    if(!check(a, 0, 3)) return false;
+    D b(std::move(a));
+    b.splice_back(std::move(a));
+    a.splice_front(std::move(b));
+    for(int i=3;i<N;i++) a.push_back(std::to_string(i));
+    return check(a, 0, N) && b.empty();
+}
+//移动赋值和 swap 也不申请内存
+template<class D>
+bool assign_swap(){
+    D a, b, c;
+    for(int i=0;i<N;i++) a.push_back(std::to_string(i));
+    for(int i=0;i<10;i++) b.push_back(std::to_string(i));
+    long long count = allocations;
+    b = std::move(a);
+    a.swap(c);
+    c = std::move(c);
+    swap(b, c);
+    if(allocations != count) return false;
+    if(!check(c, 0, N) || !b.empty() || !a.empty()) return false;
+    a = std::move(c);
+    c = a;
+    return check(a, 0, N) && check(c, 0, N);
+}
+//std::vector 扩容时用 noexcept 的移动构造搬动元素
+template<class D>
+bool in_vector(){
+    std::vector<D> v;
+    for(int i=0;i<100;i++){
+        v.emplace_back();
+        for(int j=0;j<=i;j++) v.back().push_back(std::to_string(j));
+        if(i % 10 == 0) v.shrink_to_fit();
+    }
+    for(int i=0;i<100;i++) if(!check(v[i], 0, i + 1)) return false;
+    return true;
+}
+void test1(){
+    printf("test1: moved-from state              ");
+    if(!moved_from<Deque>() || !moved_from<Rope>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: move assignment & swap        ");
+    if(!assign_swap<Deque>() || !assign_swap<Rope>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: deques in std::vector         ");
+    if(!in_vector<Deque>() || !in_vector<Rope>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    puts("test start:");
+    test1();//moved-from state
+    test2();//move assignment & swap
+    test3();//deques in std::vector
+}
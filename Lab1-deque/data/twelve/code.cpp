@@ -0,0 +1,96 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include "deque.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+int N = 50000;
+/***************************/
+
+
+//同一个程序里可以同时使用检查和不检查 iterator 的 deque
+typedef sjtu::deque<int> checked;
+typedef sjtu::deque<int, std::allocator<int>, sjtu::heap_pool, sjtu::default_chunk_size<int>::value, false> unchecked;
+static_assert(checked::check_iterator && !unchecked::check_iterator, "CheckIterators");
+static_assert(!sjtu::basic_deque<int, sjtu::tree_engine, std::allocator<int>, sjtu::heap_pool, 16, false>::check_iterator,
+              "CheckIterators of rope_deque");
+
+template<class D>
+bool throws(D &d, typename D::iterator pos){
+    try{
+        d.insert(pos, 0);
+    }catch(sjtu::invalid_iterator &){
+        return true;
+    }catch(...){}
+    return false;
+}
+//失效的 iterator 和其他 deque 的 iterator 都要被发现
+template<class D>
+bool stale(){
+    D a, b;
+    for(int i=0;i<1000;i++) a.push_back(i), b.push_back(i);
+    if(!throws(a, b.begin() + 10) || !throws(a, b.end())) return false;
+    typename D::iterator mid = a.begin() + 500, front = a.begin() + 1;
+    a.insert(a.begin() + 499, -1);
+    if(!throws(a, mid)) return false;
+    a.erase(a.begin() + 1);
+    if(!throws(a, front)) return false;
+    try{
+        a.erase(a.end());
+        return false;
+    }catch(sjtu::invalid_iterator &){}
+    try{
+        a.erase(a.begin() + 5, b.begin() + 6);
+        return false;
+    }catch(sjtu::invalid_iterator &){}
+    //仍然有效的 iterator 照常可以用
+    typename D::iterator it = a.begin() + 700;
+    a.push_back(1000);
+    a.insert(it, -2);
+    return a.size() == 1002 && a[700] == -2 && a[701] == 700 && b.size() == 1000;
+}
+//不检查时 insert、erase 的结果与检查时相同
+template<class D>
+bool same_result(){
+    D d;
+    std::deque<int> stl;
+    for(int i=0;i<N;i++){
+        size_t p = rand() % (stl.size() + 1);
+        if(i % 4 == 3){
+            if(p == stl.size()) continue;
+            d.erase(d.begin() + p);
+            stl.erase(stl.begin() + p);
+        }else{
+            d.insert(d.begin() + p, i);
+            stl.insert(stl.begin() + p, i);
+        }
+    }
+    if(d.size() != stl.size()) return false;
+    for(size_t i=0;i<stl.size();i++) if(d[i] != stl[i]) return false;
+    return true;
+}
+void test1(){
+    printf("test1: stale & foreign iterator      ");
+    if(!stale<checked>() || !stale<sjtu::rope_deque<int>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: checked & unchecked           ");
+    clock_t start = clock();
+    if(!same_result<checked>()){puts("Wrong Answer");return;}
+    clock_t mid = clock();
+    if(!same_result<unchecked>()){puts("Wrong Answer");return;}
+    fprintf(stderr, "checked %.3fs, unchecked %.3fs\n", double(mid - start) / CLOCKS_PER_SEC, double(clock() - mid) / CLOCKS_PER_SEC);
+    if(!same_result<sjtu::basic_deque<int, sjtu::tree_engine, std::allocator<int>, sjtu::heap_pool, 16, false>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(2024);
+    puts("test start:");
+    test1();//stale & foreign iterator
+    test2();//checked & unchecked
+}
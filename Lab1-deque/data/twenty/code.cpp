@@ -0,0 +1,160 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <string>
+#include "deque.hpp"
+#include "exceptions.hpp"
+
+
+/***************************/
+int N = 20000;
+/***************************/
+
+
+//记录复制和移动次数；value 为负时构造抛出异常
+int copies = 0, moves = 0;
+class heavy{
+private:
+    int x;
+    std::string payload;
+public:
+    heavy(int x, const std::string &s):x(x), payload(s){
+        if(x < 0) throw std::runtime_error("heavy");
+    }
+    heavy(const heavy &other):x(other.x), payload(other.payload){ copies++; }
+    heavy(heavy &&other) noexcept :x(other.x), payload(std::move(other.payload)){ moves++; }
+    heavy &operator=(const heavy &other){
+        x = other.x;
+        payload = other.payload;
+        copies++;
+        return *this;
+    }
+    heavy &operator=(heavy &&other) noexcept {
+        x = other.x;
+        payload = std::move(other.payload);
+        moves++;
+        return *this;
+    }
+    int num() const {return x;}
+};
+//只能移动的元素
+template<class D>
+bool move_only(){
+    D q;
+    std::deque<int> stl;
+    for(int i=0;i<N;i++){
+        size_t p = rand() % (stl.size() + 1);
+        switch(i % 6){
+        case 0: q.push_back(std::unique_ptr<int>(new int(i))); stl.push_back(i); break;
+        case 1: q.push_front(std::unique_ptr<int>(new int(i))); stl.push_front(i); break;
+        case 2: q.emplace_back(new int(i)); stl.push_back(i); break;
+        case 3: q.emplace_front(new int(i)); stl.push_front(i); break;
+        case 4: {
+            auto it = q.insert(q.begin() + p, std::unique_ptr<int>(new int(i)));
+            stl.insert(stl.begin() + p, i);
+            if(**it != i) return false;
+            break;
+        }
+        default: {
+            auto it = q.emplace(q.begin() + p, new int(i));
+            stl.insert(stl.begin() + p, i);
+            if(**it != i) return false;
+        }
+        }
+        if(i % 5 == 0){
+            p = rand() % stl.size();
+            q.erase(q.begin() + p);
+            stl.erase(stl.begin() + p);
+        }
+    }
+    if(q.size() != stl.size()) return false;
+    for(size_t i=0;i<stl.size();i++) if(*q[i] != stl[i]) return false;
+    //整个 deque 也只能移动
+    D r(std::move(q));
+    q = std::move(r);
+    D tail = q.split_at(q.begin() + stl.size() / 2);
+    q.splice_back(std::move(tail));
+    q.remove_if([](const std::unique_ptr<int> &x){ return *x % 2 == 0; });
+    size_t k = 0;
+    for(size_t i=0;i<stl.size();i++){
+        if(stl[i] % 2 == 0) continue;
+        if(*q[k++] != stl[i]) return false;
+    }
+    return k == q.size();
+}
+//右值和 emplace 不复制元素
+template<class D>
+bool no_copies(){
+    D q;
+    copies = 0;
+    for(int i=0;i<N;i++){
+        if(i % 4 == 0) q.emplace_back(i, std::string(100, 'x'));
+        else if(i % 4 == 1) q.emplace_front(i, std::string(100, 'y'));
+        else if(i % 4 == 2) q.push_back(heavy(i, "z"));
+        else q.insert(q.begin() + q.size() / 2, heavy(i, "w"));
+        if(i % 3 == 0) q.emplace(q.begin() + rand() % (q.size() + 1), i, "v");
+    }
+    q.erase(q.begin() + 10, q.begin() + 1000);
+    q.pop_front();
+    q.pop_back();
+    return copies == 0;
+}
+//参数引用着 deque 中的元素，或者构造抛出异常
+template<class D>
+bool aliasing_and_throw(){
+    D q;
+    for(int i=0;i<1000;i++) q.emplace_back(i, std::to_string(i));
+    for(int r=0;r<200;r++){
+        size_t from = rand() % q.size(), to = rand() % (q.size() + 1);
+        int expect = q[from].num();
+        auto it = q.insert(q.begin() + to, q[from]);
+        if(it->num() != expect || q[to].num() != expect) return false;
+        it = q.emplace(q.begin() + to, std::move(q[to]));
+        if(it->num() != expect) return false;
+    }
+    size_t size = q.size();
+    int first = q.front().num(), last = q.back().num();
+    for(int r=0;r<100;r++){
+        try{
+            if(r % 3 == 0) q.emplace_back(-1, "");
+            else if(r % 3 == 1) q.emplace_front(-1, "");
+            else q.emplace(q.begin() + rand() % (q.size() + 1), -1, "");
+            return false;
+        }catch(std::runtime_error &){}
+    }
+    if(q.size() != size || q.front().num() != first || q.back().num() != last) return false;
+    size_t n = 0;
+    for(auto it = q.begin(); it != q.end(); ++it) n++;
+    return n == size;
+}
+void test1(){
+    printf("test1: move-only elements            ");
+    if(!move_only<sjtu::deque<std::unique_ptr<int>>>() ||
+       !move_only<sjtu::deque<std::unique_ptr<int>, std::allocator<std::unique_ptr<int>>, sjtu::slab_pool, 8>>() ||
+       !move_only<sjtu::rope_deque<std::unique_ptr<int>, std::allocator<std::unique_ptr<int>>, sjtu::heap_pool, 8>>()){
+        puts("Wrong Answer");
+        return;
+    }
+    puts("Accept");
+}
+void test2(){
+    printf("test2: emplace without copies        ");
+    if(!no_copies<sjtu::deque<heavy>>() || !no_copies<sjtu::deque<heavy, std::allocator<heavy>, sjtu::heap_pool, sjtu::adaptive_chunk_size>>() ||
+       !no_copies<sjtu::rope_deque<heavy>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: aliasing & throwing emplace   ");
+    if(!aliasing_and_throw<sjtu::deque<heavy, std::allocator<heavy>, sjtu::heap_pool, 8>>() ||
+       !aliasing_and_throw<sjtu::rope_deque<heavy, std::allocator<heavy>, sjtu::heap_pool, 8>>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(10);
+    puts("test start:");
+    test1();//move-only elements
+    test2();//emplace without copies
+    test3();//aliasing & throwing emplace
+}
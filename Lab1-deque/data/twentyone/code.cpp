@@ -0,0 +1,81 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "deque.hpp"
+#include "exceptions.hpp"
+#include "class-counting-allocator.hpp"
+
+
+/***************************/
+int ROUNDS = 200000;
+int DEPTH = 1000;
+/***************************/
+
+
+template<class Pool>
+using Deque = sjtu::deque<int, counting_allocator<int>, Pool, 16>;
+typedef sjtu::rope_deque<int, counting_allocator<int>, sjtu::heap_pool, 16> Rope;
+
+//深度稳定的 FIFO：预热以后每次操作都不再申请内存
+template<class D>
+bool steady_fifo(size_t limit, bool expect_zero){
+    D q;
+    q.set_block_cache_limit(limit);
+    for(int i=0;i<DEPTH;i++) q.push_back(i);
+    for(int i=0;i<DEPTH;i++){
+        q.push_back(DEPTH + i);
+        q.pop_front();
+    }
+    long long before = allocations;
+    int expect = DEPTH;
+    for(int i=0;i<ROUNDS;i++){
+        q.push_back(2 * DEPTH + i);
+        if(q.front() != expect++) return false;
+        q.pop_front();
+    }
+    long long used = allocations - before;
+    return expect_zero ? used == 0 : used > 0;
+}
+//调低上限时多出来的缓存立即释放
+template<class D>
+bool lower_limit(){
+    D q;
+    if(q.block_cache_limit() != 4) return false;
+    q.set_block_cache_limit(100);
+    for(int i=0;i<10000;i++) q.push_back(i);
+    while(!q.empty()) q.pop_back();
+    long long cached = live_bytes;
+    q.set_block_cache_limit(2);
+    long long kept = live_bytes;
+    q.set_block_cache_limit(0);
+    if(!(kept < cached && live_bytes < kept)) return false;
+    //复制和 split_at 得到的 deque 沿用同样的上限
+    q.set_block_cache_limit(7);
+    for(int i=0;i<100;i++) q.push_back(i);
+    D c(q), s = q.split_at(q.begin() + 50);
+    return c.block_cache_limit() == 7 && s.block_cache_limit() == 7 && q.size() == 50 && s.size() == 50;
+}
+void test1(){
+    printf("test1: steady FIFO without malloc    ");
+    if(!steady_fifo<Deque<sjtu::heap_pool>>(4, true) || !steady_fifo<Deque<sjtu::slab_pool>>(4, true) ||
+       !steady_fifo<Deque<sjtu::cow_pool>>(4, true) || !steady_fifo<Rope>(4, true)){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: cache disabled                ");
+    //没有缓存时 heap_pool 每换一个 block 都要申请
+    if(!steady_fifo<Deque<sjtu::heap_pool>>(0, false) || !steady_fifo<Rope>(0, false)){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: set_block_cache_limit         ");
+    if(!lower_limit<Deque<sjtu::heap_pool>>() || !lower_limit<Rope>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    puts("test start:");
+    test1();//steady FIFO without malloc
+    test2();//cache disabled
+    test3();//set_block_cache_limit
+}
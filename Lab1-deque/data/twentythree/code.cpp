@@ -0,0 +1,79 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include "deque.hpp"
+#include "exceptions.hpp"
+#include "class-counting-allocator.hpp"
+
+
+/***************************/
+int N = 10000000;
+int OPS = 1000000;
+/***************************/
+
+
+typedef sjtu::deque<int, counting_allocator<int>> Deque;
+//只在一端 push 时 block 都是满的（只留一个空位），占用的内存只比元素本身多一点
+template<bool Front>
+bool dense(){
+    long long before = live_bytes;
+    peak_bytes = live_bytes;
+    {
+        Deque q;
+        clock_t start = clock();
+        for(int i=0;i<N;i++){
+            if(Front) q.push_front(i);
+            else q.push_back(i);
+        }
+        fprintf(stderr, "%d %s: %.3fs, peak %.1f MB for %.1f MB of elements\n", N, Front ? "push_front" : "push_back",
+                double(clock() - start) / CLOCKS_PER_SEC, (peak_bytes - before) / 1048576.0, N * sizeof(int) / 1048576.0);
+        if((long long)q.size() != N) return false;
+        for(int i=0;i<N;i+=997) if(q[i] != (Front ? N - 1 - i : i)) return false;
+    }
+    return live_bytes == before && (peak_bytes - before) * 100 < (long long)(N * sizeof(int)) * 105;
+}
+//两端 push 和 pop 交替进行，在 block 的边界上来回也要正确
+bool mixed(){
+    sjtu::deque<int, std::allocator<int>, sjtu::heap_pool, 8> q;
+    std::deque<int> stl;
+    for(int i=0;i<OPS;i++){
+        switch(rand() % 6){
+        case 0: case 1: q.push_back(i); stl.push_back(i); break;
+        case 2: case 3: q.push_front(i); stl.push_front(i); break;
+        case 4: if(!stl.empty()){ q.pop_back(); stl.pop_back(); } break;
+        default: if(!stl.empty()){ q.pop_front(); stl.pop_front(); }
+        }
+        if(!stl.empty() && (q.front() != stl.front() || q.back() != stl.back())) return false;
+        if(i % 1000 == 0 && !stl.empty()){
+            size_t p = rand() % stl.size();
+            if(q[p] != stl[p] || *(q.begin() + p) != stl[p] || q.end() - q.begin() != (int)stl.size()) return false;
+        }
+    }
+    size_t i = 0;
+    for(auto it = q.cbegin(); it != q.cend(); ++it, ++i) if(*it != stl[i]) return false;
+    return i == stl.size();
+}
+void test1(){
+    printf("test1: push_back fills blocks        ");
+    if(!dense<false>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test2(){
+    printf("test2: push_front fills blocks       ");
+    if(!dense<true>()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: push & pop at both ends       ");
+    if(!mixed()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(1);
+    puts("test start:");
+    test1();//push_back fills blocks
+    test2();//push_front fills blocks
+    test3();//push & pop at both ends
+}
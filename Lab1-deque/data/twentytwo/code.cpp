@@ -0,0 +1,148 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+#include "deque.hpp"
+#include "exceptions.hpp"
+#include "class-counting-allocator.hpp"
+
+
+/***************************/
+int N = 2000000;
+/***************************/
+
+
+typedef sjtu::deque<int, std::allocator<int>, sjtu::heap_pool, 64> Deque;
+//顺序访问几乎全部命中
+bool sequential(Deque &q){
+    q.reset_finger_stats();
+    if(q.finger_hits() != 0 || q.finger_misses() != 0) return false;
+    for(int i=0;i<N;i++) if(q[i] != i) return false;
+    for(int i=N-1;i>=0;i-=3) if(q.at(i) != i) return false;
+    size_t total = q.finger_hits() + q.finger_misses();
+    return total == (size_t)N + (N + 2) / 3 && q.finger_misses() * 100 < total;
+}
+//在几个相距很远的位置附近来回访问：每次换位置时不命中，附近的访问命中
+bool clustered(Deque &q){
+    q.reset_finger_stats();
+    for(int r=0;r<1000;r++){
+        int base = rand() % (N - 200);
+        for(int i=0;i<100;i++) if(q[base + i * 2] != base + i * 2) return false;
+    }
+    return q.finger_misses() <= 1000 && q.finger_hits() >= 99000;
+}
+//const 的访问不移动 finger 也不计数
+bool const_access(Deque &q){
+    q.reset_finger_stats();
+    const Deque &c = q;
+    long long sum = 0;
+    for(int i=0;i<1000;i++) sum += c[rand() % N] + c.at(i);
+    return q.finger_hits() == 0 && q.finger_misses() == 0 && sum > 0;
+}
+//修改以后 finger 仍然给出正确的结果
+bool after_modify(Deque &q){
+    for(int r=0;r<1000;r++){
+        int p = rand() % (N / 2);
+        q[p];
+        q.insert(q.begin() + p, -1);
+        if(q[p] != -1 || q[p + 1] != p) return false;
+        q.erase(q.begin() + p);
+        if(q[p] != p) return false;
+        q.push_front(-2);
+        if(q[p + 1] != p) return false;
+        q.pop_front();
+    }
+    return (int)q.size() == N && q[N - 1] == N - 1;
+}
+void test1(){
+    printf("test1: sequential access             ");
+    Deque q;
+    for(int i=0;i<N;i++) q.push_back(i);
+    clock_t start = clock();
+    if(!sequential(q)){puts("Wrong Answer");return;}
+    fprintf(stderr, "sequential access: %.3fs, hits %zu, misses %zu\n", double(clock() - start) / CLOCKS_PER_SEC, q.finger_hits(), q.finger_misses());
+    puts("Accept");
+}
+void test2(){
+    printf("test2: clustered access              ");
+    Deque q;
+    for(int i=0;i<N;i++) q.push_back(i);
+    if(!clustered(q)){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test3(){
+    printf("test3: const access                  ");
+    Deque q;
+    for(int i=0;i<N;i++) q.push_back(i);
+    if(!const_access(q)){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+void test4(){
+    printf("test4: access after modification     ");
+    Deque q;
+    for(int i=0;i<N;i++) q.push_back(i);
+    if(!after_modify(q)){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+//重建 block 目录时申请内存失败，之后的随机访问仍然会重建目录，而不是一直沿链表查找
+bool failed_rebuild(){
+    sjtu::deque<int, counting_allocator<int>, sjtu::heap_pool, 64> q;
+    for(int i=0;i<N;i++) q.push_back(i);
+    fail_at = allocations;
+    try{
+        q[N / 2];
+        return false;
+    }catch(std::bad_alloc &){}
+    long long before = allocations;
+    if(q[N / 3] != N / 3 || allocations == before) return false;
+    before = allocations;
+    for(int i=0;i<1000;i++){
+        int p = rand() % N;
+        if(q[p] != p || q.at(N - 1 - p) != N - 1 - p) return false;
+    }
+    return allocations == before;
+}
+void test5(){
+    printf("test5: failed directory rebuild      ");
+    if(!failed_rebuild()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+//几个线程同时通过非 const 的 at、[] 读同一个 deque：finger 的移动不能造成数据竞争，读出的值都正确
+bool concurrent(){
+    Deque q;
+    for(int i=0;i<N;i++) q.push_back(i);
+    q.insert(q.begin() + N / 2, -1);
+    q.erase(q.begin() + N / 2);
+    std::vector<char> ok(4, 1);
+    std::vector<std::thread> threads;
+    for(int t=0;t<4;t++){
+        threads.emplace_back([&q, &ok, t]{
+            unsigned seed = t + 1;
+            for(int r=0;r<200;r++){
+                seed = seed * 1103515245 + 12345;
+                int base = (seed >> 8) % (N - 1000);
+                for(int i=0;i<1000;i+=1+t) if(q[base + i] != base + i || q.at(N - 1 - base - i) != N - 1 - base - i) ok[t] = 0;
+            }
+        });
+    }
+    for(auto &th : threads) th.join();
+    for(int t=0;t<4;t++) if(!ok[t]) return false;
+    return q.finger_hits() + q.finger_misses() > 0;
+}
+void test6(){
+    printf("test6: concurrent non-const access   ");
+    if(!concurrent()){puts("Wrong Answer");return;}
+    puts("Accept");
+}
+int main(){
+    srand(3);
+    puts("test start:");
+    test1();//sequential access
+    test2();//clustered access
+    test3();//const access
+    test4();//access after modification
+    test5();//failed directory rebuild
+    test6();//concurrent non-const access
+}
@@ -3,792 +3,1578 @@
 
 #include "exceptions.hpp"
 
+#include <atomic>
 #include <cstddef>
-namespace sjtu { 
-const size_t chunk_size = 512;
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define SJTU_DEQUE_HAS_PMR
+#endif
+#endif
+namespace sjtu {
+//默认的 block 大小：每个 block 大约占 block_bytes 字节，但至少能放 min_chunk_size 个元素
+const size_t block_bytes = 4096;
+const size_t min_chunk_size = 16;
 template<class T>
-class deque {
+struct default_chunk_size {
+    static const size_t value = sizeof(T) * min_chunk_size >= block_bytes ? min_chunk_size : block_bytes / sizeof(T);
+};
+//block 大小取 adaptive_chunk_size 时，新 block 的容量随 deque 的长度 n 增长到约 sqrt(n)（2 的幂），
+//最小 min_chunk_size，最大 max_adaptive_chunk_size
+const size_t adaptive_chunk_size = 0;
+const size_t max_adaptive_chunk_size = 1 << 16;
+/**
+ * block 存储空间的分配策略，作为 deque 的第三个模板参数。
+ * 它们本身不直接向系统要内存，而是通过 upstream（提供 allocate(bytes) 和 deallocate(p, bytes)）申请。
+ * 同一个 deque 的 block 大小可能不止一种（自适应 block 大小时），所以 allocate 和 deallocate 都带上字节数。
+ * deque 交换时 pool 也用 std::swap 一起交换，所以 Pool 需要可以移动。
+ * transferable 表示 block 可以单独交给另一个（分配器相等的）deque 释放，splice 和 split_at 只在这时才能直接交出 block。
+ * shares_blocks 表示 block 可以被多个 deque 共享（见 cow_pool）。
+ * heap_pool：每个 block 单独申请，释放时立即归还，是默认的 Pool；稳定运行时反复用到的 block 由 deque 自己的 block 缓存复用。
+ */
+class heap_pool {
 public:
-    class map_node;
+    static const bool transferable = true;
+    static const bool shares_blocks = false;
+    template<class Upstream>
+    void* allocate(Upstream &up, size_t bytes) { return up.allocate(bytes); }
+    template<class Upstream>
+    void deallocate(Upstream &up, void* p, size_t bytes) { up.deallocate(p, bytes); }
+    template<class Upstream>
+    void release(Upstream &) {}
+};
+/**
+ * slab_pool：一次申请一个 slab，切成若干个同样大小的 block；释放的 block 串在它所在 slab 的空闲链表上等待复用。
+ * slab 中的 block 个数从 1 开始倍增，最多 max_slab_blocks 个，所以小的 deque 不会浪费内存，大的 deque 只需要很少几次申请和释放。
+ * 每个 block 前面有一个头部记录它所在的 slab，一个 slab 的 block 全部释放以后，每种大小最多保留一个空的 slab，
+ * 多出来的立即归还 upstream，所以 deque 缩小以后占用的内存也会跟着减少，而不是一直保持在峰值。
+ * 每种 block 大小是一个 size_class，最多 max_classes 种，再多的大小直接向 upstream 申请和归还。
+ * block 属于某个 slab，不能单独交给另一个 deque，所以 splice 和 split_at 会退化为逐个移动元素。
+ */
+class slab_pool {
 private:
-    //deque 的参数：头（虚节点），尾（虚节点）和当前数据的个数
-    map_node* head;
-    map_node* tail;
-    size_t map_size;
-public:
-    class chunk_node {
-    public:
-        //chunk_node 是一个 block（也叫chunk）上的结点的类型
-        chunk_node* prev;
-        chunk_node* next;
-        T* data;
-        chunk_node():prev(nullptr), next(nullptr), data(nullptr) {}
+    struct slab;
+    struct free_block {
+        free_block* next;
     };
-    class map_node {
-    public:
-        //map_node 记录其指向的 chunk 的第一个结点和最后一个结点（虚节点）
-        map_node* prev;
-        map_node* next;
-        chunk_node* fir_node;
-        chunk_node* las_node;
-        //chunk 的长度
-        size_t length;
-        //chunk 的 index（第几个chunk）
-        size_t index;
-        map_node():prev(nullptr), next(nullptr), fir_node(nullptr), las_node(nullptr), length(0), index(0) {}
+    //block 的头部：所在的 slab，直接向 upstream 申请的 block 为 nullptr
+    struct block_header {
+        slab* owner;
     };
-    class const_iterator;
-    class iterator {
-    private:
-        //指向 iterator 所在 deque 的指针
-        deque<T> *deq;
-        //当前 iterator 指向的 chunk_node（存放了data）
-        chunk_node* cur;
-        //cur 在这个 chunk 上的 index
-        size_t cur_ind;
-        //指向这个 chunk 所在 map_node
-        map_node* node;
-    public:
-        iterator():deq(nullptr), cur(nullptr), cur_ind(0), node(nullptr) {}
-        iterator(deque<T> *host_deq, chunk_node* current,
-                 size_t ind, map_node* cur_node):
-        deq(host_deq), cur(current), cur_ind(ind), node(cur_node) {}
-        iterator(const iterator &other):
-        deq(other.deq), cur(other.cur), cur_ind(other.cur_ind), node(other.node) {}
-        iterator(const const_iterator &other):
-        deq(other.deq), cur(other.cur), cur_ind(other.cur_ind), node(other.node) {}
-        /**
-         * return a new iterator which pointer n-next elements
-         * even if there are not enough elements, the behaviour is **undefined**.
-         * as well as operator-
-         * however if the iterator exceed only before begin(), or after end(),
-         * the program should still run **without causing an error**
-         * notice that n can be negative!!!
-         */
-        iterator operator+(const int &n) const {
-            if (n > 0) {
-                int n_tmp = n;
-                iterator tmp(deq, cur, cur_ind, node);
-                while (tmp.node->next != deq->tail && tmp.cur_ind + n_tmp >= tmp.node->length) {
-                    n_tmp -= tmp.node->length - tmp.cur_ind;
-                    tmp.node = tmp.node->next;
-                    tmp.cur = tmp.node->fir_node;
-                    tmp.cur_ind = 0;
-                }
-                while (n_tmp--) {
-                    tmp.cur = tmp.cur->next;
-                    tmp.cur_ind++;
-                }
-                return tmp;
-            } else if (n < 0) {
-            int n_tmp = -n;
-                iterator tmp(deq, cur, cur_ind, node);
-                while (tmp.cur_ind < n_tmp && tmp.node->prev != tmp.deq->head) {
-                    n_tmp -= tmp.cur_ind + 1;
-                    tmp.node = tmp.node->prev;
-                    tmp.cur = tmp.node->las_node;
-                    tmp.cur = tmp.cur->prev;
-                    tmp.cur_ind = tmp.node->length - 1;
-                }
-                while (n_tmp--) {
-                    tmp.cur = tmp.cur->prev;
-                    tmp.cur_ind--;
-                }
-                return tmp;
-            } else {
-                return *this;
-            }
+    struct slab {
+        //同一个 size_class 的 slab 串成双向链表，有空闲 block 的 slab 都排在已经用满的 slab 前面
+        slab* prev;
+        slab* next;
+        size_t bytes;
+        //已经分出去的 block 个数
+        size_t used;
+        free_block* free_list;
+    };
+    struct size_class {
+        size_t bytes;
+        size_t next_blocks;
+        slab* first;
+        slab* last;
+        //used 为 0 的 slab 个数，最多为 1
+        size_t empty_slabs;
+    };
+    static const size_t max_slab_blocks = 256;
+    static const size_t max_classes = 16;
+    //slab 头部、block 头部和每个 block 都按 max_align_t 对齐
+    static size_t align(size_t bytes) {
+        return (bytes + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+    }
+    static size_t header() { return align(sizeof(block_header)); }
+    static block_header* header_of(void* p) {
+        return reinterpret_cast<block_header*>(static_cast<char*>(p) - header());
+    }
+    size_class classes[max_classes];
+    size_t class_count;
+    //找到 bytes 对应的 size_class，没有时新建一个；种类已满时返回 nullptr
+    size_class* find_class(size_t bytes, bool create) {
+        for (size_t i = 0; i < class_count; ++i) {
+            if (classes[i].bytes == bytes) return classes + i;
         }
-        iterator operator-(const int &n) const {
-            if (n < 0) {
-                int n_tmp = -n;
-                iterator tmp(deq, cur, cur_ind, node);
-                while (tmp.node->next != deq->tail && tmp.cur_ind + n_tmp >= tmp.node->length) {
-                    n_tmp -= tmp.node->length - tmp.cur_ind;
-                    tmp.node = tmp.node->next;
-                    tmp.cur = tmp.node->fir_node;
-                    tmp.cur_ind = 0;
-                }
-                while (n_tmp--) {
-                    tmp.cur = tmp.cur->next;
-                    tmp.cur_ind++;
-                }
-                return tmp;
-            } else if (n > 0) {
-            int n_tmp = n;
-                iterator tmp(deq, cur, cur_ind, node);
-                while (tmp.cur_ind < n_tmp && tmp.node->prev != tmp.deq->head) {
-                    n_tmp -= tmp.cur_ind + 1;
-                    tmp.node = tmp.node->prev;
-                    tmp.cur = tmp.node->las_node;
-                    tmp.cur = tmp.cur->prev;
-                    tmp.cur_ind = tmp.node->length - 1;
-                }
-                while (n_tmp--) {
-                    tmp.cur = tmp.cur->prev;
-                    tmp.cur_ind--;
-                }
-                return tmp;
-            } else {
-                return *this;
+        if (!create || class_count == max_classes) return nullptr;
+        size_class* cls = classes + class_count++;
+        cls->bytes = bytes;
+        cls->next_blocks = 1;
+        cls->first = cls->last = nullptr;
+        cls->empty_slabs = 0;
+        return cls;
+    }
+    static void unlink(size_class* cls, slab* s) {
+        (s->prev == nullptr ? cls->first : s->prev->next) = s->next;
+        (s->next == nullptr ? cls->last : s->next->prev) = s->prev;
+    }
+    static void link_front(size_class* cls, slab* s) {
+        s->prev = nullptr;
+        s->next = cls->first;
+        (cls->first == nullptr ? cls->last : cls->first->prev) = s;
+        cls->first = s;
+    }
+    static void link_back(size_class* cls, slab* s) {
+        s->next = nullptr;
+        s->prev = cls->last;
+        (cls->last == nullptr ? cls->first : cls->last->next) = s;
+        cls->last = s;
+    }
+    //把 s 放进 cls：已经有一个空的 slab 时直接归还 s
+    template<class Upstream>
+    static void insert_slab(Upstream &up, size_class* cls, slab* s) {
+        if (s->used == 0) {
+            if (cls->empty_slabs != 0) {
+                up.deallocate(s, s->bytes);
+                return;
             }
+            cls->empty_slabs++;
         }
-        /**
-         *  return the signed distance between two iterator,
-         *  if these two iterators points to different vectors, throw invaild_iterator.
-         *  notice size_t is a very dangerous type which should mainly used by comparison
-         */
-        int operator-(const iterator &rhs) const {
-            if (deq != rhs.deq) throw invalid_iterator();
-            int tmp = 0;
-            iterator tmp_it = *this;
-            if (node->index > rhs.node->index) {
-                map_node* tmp_node = rhs.node;
-                tmp += rhs.node->length - rhs.cur_ind;
-                tmp_node = tmp_node->next;
-                while (tmp_node->index < node->index) {
-                    tmp += tmp_node->length;
-                    tmp_node = tmp_node->next;
-                }
-                tmp += cur_ind;
-                //you can't write: (node->index - rhs.node->index < 0)
-            } else if (node->index < rhs.node->index) {
-                map_node* tmp_node = node;
-                tmp -= int(node->length - cur_ind);
-                tmp_node = tmp_node->next;
-                while (tmp_node->index < rhs.node->index) {
-                    tmp -= int(tmp_node->length);
-                    tmp_node = tmp_node->next;
-                }
-                tmp -= int(rhs.cur_ind);
-            } else {
-                tmp = int(cur_ind) - int(rhs.cur_ind);
-            }
-            return tmp;
-        }
-        iterator& operator+=(const int &n) {
-            if (n > 0) {
-                int n_tmp = n;
-                while (node->next != deq->tail && cur_ind + n_tmp >= node->length) {
-                    n_tmp -= node->length - cur_ind;
-                    node = node->next;
-                    cur = node->fir_node;
-                    cur_ind = 0;
-                }
-                while (n_tmp--) {
-                    cur = cur->next;
-                    cur_ind++;
-                }
-            } else if (n < 0) {
-                int n_tmp = -n;
-                while (cur_ind < n_tmp && node->prev != deq->head) {
-                    n_tmp -= cur_ind + 1;
-                    node = node->prev;
-                    cur = node->las_node;
-                    cur = cur->prev;
-                    cur_ind = node->length - 1;
-                }
-                while (n_tmp--) {
-                    cur = cur->prev;
-                    cur_ind--;
-                }
+        if (s->free_list != nullptr) link_front(cls, s);
+        else link_back(cls, s);
+    }
+public:
+    static const bool transferable = false;
+    static const bool shares_blocks = false;
+    slab_pool():class_count(0) {}
+    template<class Upstream>
+    void* allocate(Upstream &up, size_t bytes) {
+        bytes = align(bytes < sizeof(free_block) ? sizeof(free_block) : bytes);
+        size_class* cls = find_class(bytes, true);
+        if (cls == nullptr) {
+            char* base = static_cast<char*>(up.allocate(header() + bytes));
+            reinterpret_cast<block_header*>(base)->owner = nullptr;
+            return base + header();
+        }
+        if (cls->first == nullptr || cls->first->free_list == nullptr) {
+            size_t unit = header() + bytes;
+            size_t slab_bytes = align(sizeof(slab)) + cls->next_blocks * unit;
+            slab* new_slab = static_cast<slab*>(up.allocate(slab_bytes));
+            new_slab->bytes = slab_bytes;
+            new_slab->used = 0;
+            new_slab->free_list = nullptr;
+            char* ptr = reinterpret_cast<char*>(new_slab) + align(sizeof(slab));
+            for (size_t i = 0; i < cls->next_blocks; ++i, ptr += unit) {
+                reinterpret_cast<block_header*>(ptr)->owner = new_slab;
+                free_block* block = reinterpret_cast<free_block*>(ptr + header());
+                block->next = new_slab->free_list;
+                new_slab->free_list = block;
             }
-            return *this;
-        }
-        iterator& operator-=(const int &n) {
-            if (n < 0) {
-                int n_tmp = -n;
-                while (node->next != deq->tail && cur_ind + n_tmp >= node->length) {
-                    n_tmp -= node->length - cur_ind;
-                    node = node->next;
-                    cur = node->fir_node;
-                    cur_ind = 0;
-                }
-                while (n_tmp--) {
-                    cur = cur->next;
-                    cur_ind++;
-                }
-            } else if (n > 0) {
-                int n_tmp = n;
-                while (cur_ind < n_tmp && node->prev != deq->head) {
-                    n_tmp -= cur_ind + 1;
-                    node = node->prev;
-                    cur = node->las_node;
-                    cur = cur->prev;
-                    cur_ind = node->length - 1;
-                }
-                while (n_tmp--) {
-                    cur = cur->prev;
-                    cur_ind--;
-                }
+            if (cls->next_blocks < max_slab_blocks) cls->next_blocks <<= 1;
+            cls->empty_slabs++;
+            link_front(cls, new_slab);
+        }
+        slab* s = cls->first;
+        free_block* block = s->free_list;
+        s->free_list = block->next;
+        if (s->used++ == 0) cls->empty_slabs--;
+        //用满的 slab 移到最后
+        if (s->free_list == nullptr && s != cls->last) {
+            unlink(cls, s);
+            link_back(cls, s);
+        }
+        return block;
+    }
+    template<class Upstream>
+    void deallocate(Upstream &up, void* p, size_t bytes) {
+        bytes = align(bytes < sizeof(free_block) ? sizeof(free_block) : bytes);
+        slab* s = header_of(p)->owner;
+        if (s == nullptr) {
+            up.deallocate(header_of(p), header() + bytes);
+            return;
+        }
+        size_class* cls = find_class(bytes, false);
+        bool was_full = s->free_list == nullptr;
+        free_block* block = static_cast<free_block*>(p);
+        block->next = s->free_list;
+        s->free_list = block;
+        if (--s->used == 0) {
+            unlink(cls, s);
+            insert_slab(up, cls, s);
+        } else if (was_full) {
+            unlink(cls, s);
+            link_front(cls, s);
+        }
+    }
+    template<class Upstream>
+    void release(Upstream &up) {
+        for (size_t i = 0; i < class_count; ++i) {
+            while (classes[i].first != nullptr) {
+                slab* tmp = classes[i].first;
+                classes[i].first = tmp->next;
+                up.deallocate(tmp, tmp->bytes);
             }
-            return *this;
-        }
-        /**
-         * TODO iter++
-         */
-        iterator operator++(int) {
-            iterator tmp(deq, cur, cur_ind, node);
-            if (cur_ind + 1 < node->length || (cur_ind + 1 >= node->length && node->next == deq->tail)) {
-                cur_ind++;
-                cur = cur->next;
-            } else {
-                cur_ind = 0;
-                node = node->next;
-                cur = node->fir_node;
+        }
+        class_count = 0;
+    }
+};
+/**
+ * cow_pool：和 heap_pool 一样每个 block 单独申请，但在存储空间前面放一个引用计数，
+ * deque 的复制（复制构造和赋值，分配器相等时）因此只共享所有 block 而不复制元素，O(#blocks)，适合做快照。
+ * 共享的 block 在任何一方第一次修改它时才复制出自己独占的一份（copy-on-write）。
+ * 引用计数是原子的，共享 block 的几个 deque 可以分别在不同的线程中使用。
+ * 注意：非 const 的 at、[]、iterator 的 * 和 -> 也算作修改；复制会把元素搬到新的存储空间，
+ * 之前取得的元素引用和指针随之失效，iterator 仍然有效。
+ */
+class cow_pool {
+private:
+    typedef std::atomic<size_t> ref_count;
+    //引用计数占用的字节数，保持存储空间按 max_align_t 对齐
+    static size_t header() {
+        return (sizeof(ref_count) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+    }
+    static ref_count* count(void* p) {
+        return reinterpret_cast<ref_count*>(static_cast<char*>(p) - header());
+    }
+public:
+    static const bool transferable = true;
+    static const bool shares_blocks = true;
+    template<class Upstream>
+    void* allocate(Upstream &up, size_t bytes) {
+        char* base = static_cast<char*>(up.allocate(header() + bytes));
+        new (base) ref_count(1);
+        return base + header();
+    }
+    //只在最后一个使用者手里释放
+    template<class Upstream>
+    void deallocate(Upstream &up, void* p, size_t bytes) {
+        count(p)->~ref_count();
+        up.deallocate(static_cast<char*>(p) - header(), header() + bytes);
+    }
+    template<class Upstream>
+    void release(Upstream &) {}
+    //又多了一个 deque 使用 p
+    static void share(void* p) { count(p)->fetch_add(1, std::memory_order_relaxed); }
+    //p 是否只有一个使用者
+    static bool unique(void* p) { return count(p)->load(std::memory_order_acquire) == 1; }
+    //放弃对 p 的使用：还有别的使用者时返回 true；
+    //自己已经是最后一个使用者时返回 false，计数不变，由调用者照常析构元素并释放
+    static bool release_shared(void* p) {
+        if (unique(p)) return false;
+        if (count(p)->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            count(p)->store(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+};
+//把 count 个 value 看成一个区间，insert(pos, count, value) 和 assign(count, value) 借用区间版本的实现
+template<class T>
+struct repeat_iterator {
+    const T* value;
+    size_t left;
+    const T &operator*() const { return *value; }
+    repeat_iterator &operator++() {
+        left--;
+        return *this;
+    }
+    bool operator==(const repeat_iterator &rhs) const { return left == rhs.left; }
+    bool operator!=(const repeat_iterator &rhs) const { return left != rhs.left; }
+};
+/**
+ * byte_upstream 把 Allocator 包装成按字节申请内存的接口，作为 pool 的 upstream。
+ * 以 max_align_t 为单位向 Allocator 申请，保证结点和元素的对齐。
+ */
+template<class Allocator>
+struct byte_upstream {
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<std::max_align_t> unit_allocator;
+    typedef std::allocator_traits<unit_allocator> unit_traits;
+    Allocator alloc;
+    explicit byte_upstream(const Allocator &a):alloc(a) {}
+    static size_t units(size_t bytes) {
+        return (bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+    }
+    void* allocate(size_t bytes) const {
+        unit_allocator a(alloc);
+        return unit_traits::allocate(a, units(bytes));
+    }
+    void deallocate(void* p, size_t bytes) const {
+        unit_allocator a(alloc);
+        unit_traits::deallocate(a, static_cast<std::max_align_t*>(p), units(bytes));
+    }
+};
+/**
+ * block_node：deque 和 rope_deque 共用的 block（也叫 chunk），元素连续地存放在 data 指向的一段未初始化内存中。
+ * 两种容器的结点在此基础上分别加上链表（list_node）或 treap（rope_node）的指针。
+ */
+template<class T, size_t ChunkSize>
+class block_node {
+public:
+    typedef T value_type;
+    //ChunkSize 为 adaptive_chunk_size 时每个 block 有自己的容量，chunk_size 是容量的上限
+    static const bool adaptive = ChunkSize == adaptive_chunk_size;
+    static const size_t chunk_size = adaptive ? max_adaptive_chunk_size : ChunkSize;
+    //data 是容量为 capacity() 的循环队列，start 是第一个元素在 data 中的位置
+    T* data;
+    size_t start;
+    //自适应 block 大小时 block 的容量，否则不使用
+    size_t cap;
+    //chunk 的长度
+    size_t length;
+    //chunk 的版本号：元素在 chunk 中的下标发生变化或 chunk 被删除时加一，iterator 记录创建时的版本号
+    size_t stamp;
+    block_node():data(nullptr), start(0), cap(0), length(0), stamp(0) {}
+    //chunk 的容量，长度达到容量时 spilt
+    size_t capacity() const { return adaptive ? cap : chunk_size; }
+    //chunk 中第 ind 个元素的地址
+    T* get(size_t ind) const {
+        ind += start;
+        if (ind >= capacity()) ind -= capacity();
+        return data + ind;
+    }
+    //把 src 处的元素搬到未初始化的 dst 处
+    static void relocate(T* dst, T* src) {
+        new (dst) T(std::move(*src));
+        src->~T();
+    }
+    //在第 ind 个元素前空出一个位置并返回其地址，移动前后两部分中较短的那一部分
+    T* make_room(size_t ind) {
+        if (ind != length) stamp++;
+        if (ind < length - ind) {
+            start = (start == 0 ? capacity() - 1 : start - 1);
+            for (size_t i = 0; i < ind; ++i) relocate(get(i), get(i + 1));
+        } else {
+            for (size_t i = length; i > ind; --i) relocate(get(i), get(i - 1));
+        }
+        length++;
+        return get(ind);
+    }
+    //删除第 ind 个元素留下的空位（元素已经由调用者析构），同样只移动较短的那一部分
+    void remove(size_t ind) {
+        if (ind + 1 != length) stamp++;
+        if (ind < length - 1 - ind) {
+            for (size_t i = ind; i > 0; --i) relocate(get(i), get(i - 1));
+            start = (start + 1 == capacity() ? 0 : start + 1);
+        } else {
+            for (size_t i = ind; i + 1 < length; ++i) relocate(get(i), get(i + 1));
+        }
+        length--;
+    }
+    //删除从第 ind 个开始的 k 个元素留下的空位（元素已经由调用者析构），同样只移动较短的那一部分
+    void remove_range(size_t ind, size_t k) {
+        if (ind + k != length) stamp++;
+        if (ind < length - k - ind) {
+            for (size_t i = ind; i > 0; --i) relocate(get(i - 1 + k), get(i - 1));
+            start += k;
+            if (start >= capacity()) start -= capacity();
+        } else {
+            for (size_t i = ind; i + k < length; ++i) relocate(get(i), get(i + k));
+        }
+        length -= k;
+    }
+};
+/**
+ * block_storage：deque 和 rope_deque 共用的内存管理，两者都私有继承它。
+ * 结点（Node 是 block_node 的派生类，带有 next 指针和 clear_links()）每 node_group 个一组申请，
+ * 被删除的结点不立即释放，而是（版本号加一后）串在 spare_node 上等待复用，直到容器析构，
+ * 这样失效的 iterator 仍然可以安全地读出 node->stamp，检查合法性只需要 O(1)。
+ * 删掉的 block 连同存储空间一起缓存（最多 cache_limit 个），block 的存储空间由 pool 通过 upstream 申请。
+ */
+template<class T, class Allocator, class Pool, class Node>
+class block_storage {
+protected:
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef byte_upstream<Allocator> upstream;
+    Node* spare_node;
+    //clear、pop 和 erase 删掉的 block 连同存储空间一起留在这里，new_block 优先从这里取
+    Node* cached_block;
+    size_t cached_blocks;
+    size_t cache_limit;
+    //结点每 node_group 个一组申请，每组的第一个用来把所有组串起来，析构时整组释放
+    static const size_t node_group = 32;
+    Node* node_groups;
+    //upstream 是容器所有内存的来源，pool 负责 block 中元素的存储空间
+    upstream up;
+    Pool pool;
+
+    explicit block_storage(const Allocator &alloc):spare_node(nullptr), cached_block(nullptr), cached_blocks(0),
+    cache_limit(4), node_groups(nullptr), up(alloc), pool() {}
+    //容器在析构函数中先释放自己的所有 block，剩下的由这里归还
+    ~block_storage() {
+        release_storage();
+    }
+    //取一个空闲的结点，没有的话再申请一组
+    Node* new_node() {
+        if (spare_node == nullptr) {
+            Node* group = static_cast<Node*>(up.allocate(sizeof(Node) * node_group));
+            for (size_t i = 0; i < node_group; ++i) new (group + i) Node;
+            group->next = node_groups;
+            node_groups = group;
+            for (size_t i = 1; i < node_group; ++i) {
+                group[i].next = spare_node;
+                spare_node = group + i;
             }
-            return tmp;
-        }
-        /**
-         * TODO ++iter
-         */
-        iterator& operator++() {
-            if (cur_ind + 1 < node->length || (cur_ind + 1 >= node->length && node->next == deq->tail)) {
-                cur_ind++;
-                cur = cur->next;
-            } else {
-                cur_ind = 0;
-                node = node->next;
-                cur = node->fir_node;
+        }
+        Node* node = spare_node;
+        spare_node = node->next;
+        node->next = nullptr;
+        node->start = 0;
+        node->length = 0;
+        return node;
+    }
+    //申请容量至少为 cap 的空 block（data 只分配内存而不构造元素），优先使用缓存中的 block
+    Node* new_block(size_t cap) {
+        Node** ptr = &cached_block;
+        while (*ptr != nullptr && (*ptr)->capacity() < cap) ptr = &(*ptr)->next;
+        if (*ptr != nullptr) {
+            Node* block = *ptr;
+            *ptr = block->next;
+            cached_blocks--;
+            block->next = nullptr;
+            return block;
+        }
+        Node* block = new_node();
+        block->cap = cap;
+        block->data = static_cast<T*>(pool.allocate(up, sizeof(T) * block->capacity()));
+        return block;
+    }
+    //析构 block 中第 from 到 to - 1 个元素（默认为全部），元素不需要析构时什么都不做
+    void destroy_elements(Node* block, size_t from = 0, size_t to = size_t(-1)) {
+        if (std::is_trivially_destructible<T>::value) return;
+        if (to > block->length) to = block->length;
+        for (size_t i = from; i < to; ++i) alloc_traits::destroy(up.alloc, block->get(i));
+    }
+    //把存储空间已经释放或者交了出去的结点放回 spare_node
+    void drop_node(Node* block) {
+        block->data = nullptr;
+        block->length = 0;
+        block->stamp++;
+        block->clear_links();
+        block->next = spare_node;
+        spare_node = block;
+    }
+    //析构 block 中的所有元素并释放 block 的存储空间，结点本身留给 spare_node 复用
+    //存储空间还被别的容器共享时只放弃自己的那一份
+    void delete_block(Node* block) {
+        if (!release_shared(block, shares_blocks())) {
+            destroy_elements(block);
+            pool.deallocate(up, block->data, sizeof(T) * block->capacity());
+        }
+        drop_node(block);
+    }
+    //析构 block 中的元素后把它连同存储空间一起缓存起来，缓存满了就直接释放
+    void cache_block(Node* block) {
+        if (cached_blocks >= cache_limit || is_shared(block, shares_blocks())) {
+            delete_block(block);
+            return;
+        }
+        destroy_elements(block);
+        block->start = 0;
+        block->length = 0;
+        block->stamp++;
+        block->clear_links();
+        block->next = cached_block;
+        cached_block = block;
+        cached_blocks++;
+    }
+    //Pool 为 cow_pool 时 block 的存储空间可能和别的容器共享，其它 Pool 下这几个函数什么都不做
+    typedef std::integral_constant<bool, Pool::shares_blocks> shares_blocks;
+    bool is_shared(Node* block, std::true_type) const {
+        return block->data != nullptr && !Pool::unique(block->data);
+    }
+    bool is_shared(Node*, std::false_type) const { return false; }
+    bool release_shared(Node* block, std::true_type) { return Pool::release_shared(block->data); }
+    bool release_shared(Node*, std::false_type) { return false; }
+    //修改 block 之前调用：存储空间还和别的容器共享时，先复制出自己独占的一份，O(chunk_size)
+    //元素在 block 中的下标不变，所以 stamp 不变
+    //只在 Pool 共享 block 时才实例化复制元素的代码，其它 Pool 下元素可以是只能移动的类型
+    void unshare(Node* block) { unshare(block, shares_blocks()); }
+    void unshare(Node*, std::false_type) {}
+    void unshare(Node* block, std::true_type) {
+        if (!is_shared(block, shares_blocks())) return;
+        T* data = static_cast<T*>(pool.allocate(up, sizeof(T) * block->capacity()));
+        size_t i = 0;
+        try {
+            for (; i < block->length; ++i) alloc_traits::construct(up.alloc, data + i, *block->get(i));
+        } catch (...) {
+            for (size_t j = 0; j < i; ++j) alloc_traits::destroy(up.alloc, data + j);
+            pool.deallocate(up, data, sizeof(T) * block->capacity());
+            throw;
+        }
+        //复制的过程中别的容器都放弃了共享时，旧的存储空间由自己析构并释放
+        if (!release_shared(block, shares_blocks())) {
+            destroy_elements(block);
+            pool.deallocate(up, block->data, sizeof(T) * block->capacity());
+        }
+        block->data = data;
+        block->start = 0;
+    }
+    //析构 block 中的元素，使它变为空的 block；共享的存储空间直接放弃，换一块新的
+    void reset_block(Node* block) {
+        if (is_shared(block, shares_blocks())) {
+            T* data = static_cast<T*>(pool.allocate(up, sizeof(T) * block->capacity()));
+            if (!release_shared(block, shares_blocks())) {
+                destroy_elements(block);
+                pool.deallocate(up, block->data, sizeof(T) * block->capacity());
             }
-            return *this;
-        }
-        /**
-         * TODO iter--
-         */
-        iterator operator--(int) {
-            iterator tmp(deq, cur, cur_ind, node);
-            if (cur_ind == 0 && node->prev != deq->head) {
-                node = node->prev;
-                cur_ind = node->length - 1;
-                cur = node->las_node->prev;
-            } else {
-                cur_ind--;
-                cur = cur->prev;
+            block->data = data;
+        } else {
+            destroy_elements(block);
+        }
+        block->start = 0;
+        block->length = 0;
+        block->stamp++;
+    }
+    //把 src 中的元素复制到空 block 中，从 data[0] 开始连续存放，count 跟着增加
+    //trivially copyable 的元素最多两次 memcpy（src 的环形缓冲区可能绕回开头）
+    void copy_block(Node* block, const Node* src, size_t &count, std::true_type) {
+        size_t first = src->capacity() - src->start;
+        if (first > src->length) first = src->length;
+        std::memcpy(static_cast<void*>(block->data), src->data + src->start, sizeof(T) * first);
+        std::memcpy(static_cast<void*>(block->data + first), src->data, sizeof(T) * (src->length - first));
+        block->length = src->length;
+        count += src->length;
+    }
+    void copy_block(Node* block, const Node* src, size_t &count, std::false_type) {
+        //逐个构造，length 和 count 跟着增加，构造抛出异常时容器仍然是完整的
+        for (size_t i = 0; i < src->length; ++i) {
+            alloc_traits::construct(up.alloc, block->data + i, *src->get(i));
+            block->length++;
+            count++;
+        }
+    }
+    //把 nodes 这条链上的结点放回 spare_node
+    void give_nodes(Node* nodes) {
+        while (nodes != nullptr) {
+            Node* node = nodes;
+            nodes = nodes->next;
+            node->next = spare_node;
+            spare_node = node;
+        }
+    }
+    //取出 count 个空闲的结点串成一条链，申请内存失败时全部放回再抛出异常
+    Node* take_nodes(size_t count) {
+        Node* nodes = nullptr;
+        try {
+            for (size_t i = 0; i < count; ++i) {
+                Node* node = new_node();
+                node->next = nodes;
+                nodes = node;
             }
-            return tmp;
-        }
-        /**
-         * TODO --iter
-         */
-        iterator& operator--() {
-            if (cur_ind == 0 && node->prev != deq->head) {
-                node = node->prev;
-                cur_ind = node->length - 1;
-                cur = node->las_node->prev;
-            } else {
-                cur_ind--;
-                cur = cur->prev;
+        } catch (...) {
+            give_nodes(nodes);
+            throw;
+        }
+        return nodes;
+    }
+    //splice 和 split_at 在两个容器之间只交出存储空间和元素：接收的一方用自己的结点 node 接住 block 的内容，
+    //block 留给原来的容器 owner 的 spare_node 复用，所以结点总是属于申请它的容器，反复交换 block 也不会在某一边越积越多
+    static void hand_over(block_storage &owner, Node* block, Node* node) {
+        node->data = block->data;
+        node->start = block->start;
+        node->cap = block->cap;
+        node->length = block->length;
+        owner.drop_node(block);
+    }
+    //把所有内存还给 Allocator（容器中的 block 应该已经释放）
+    void release_storage() {
+        while (cached_block != nullptr) {
+            pool.deallocate(up, cached_block->data, sizeof(T) * cached_block->capacity());
+            cached_block = cached_block->next;
+        }
+        cached_blocks = 0;
+        pool.release(up);
+        while (node_groups != nullptr) {
+            Node* tmp = node_groups;
+            node_groups = node_groups->next;
+            up.deallocate(tmp, sizeof(Node) * node_group);
+        }
+        spare_node = nullptr;
+    }
+    //交换除分配器以外的全部内存，O(1)
+    void swap_storage(block_storage &other) {
+        std::swap(spare_node, other.spare_node);
+        std::swap(cached_block, other.cached_block);
+        std::swap(cached_blocks, other.cached_blocks);
+        std::swap(cache_limit, other.cache_limit);
+        std::swap(node_groups, other.node_groups);
+        std::swap(pool, other.pool);
+    }
+    //只有 propagate 为 true 时才真正复制分配器，否则分配器可能根本不能赋值
+    void assign_alloc(const Allocator &alloc, std::true_type) { up.alloc = alloc; }
+    void assign_alloc(const Allocator &, std::false_type) {}
+    void swap_alloc(block_storage &other, std::true_type) { std::swap(up.alloc, other.up.alloc); }
+    void swap_alloc(block_storage &, std::false_type) {}
+public:
+    Allocator get_allocator() const { return up.alloc; }
+    /**
+     * the maximum number of emptied blocks kept (with their storage) for reuse instead of being freed.
+     * a queue with stable depth needs only one or two to stop allocating; the default is 4.
+     * lowering the limit frees the extra cached blocks immediately.
+     */
+    size_t block_cache_limit() const { return cache_limit; }
+    void set_block_cache_limit(size_t limit) {
+        cache_limit = limit;
+        while (cached_blocks > cache_limit) {
+            Node* block = cached_block;
+            cached_block = block->next;
+            cached_blocks--;
+            delete_block(block);
+        }
+    }
+};
+/**
+ * deque 和 rope_deque 共用的 iterator，Const 为 true 时是 const_iterator。
+ * 记录所在的容器、所在的 block、在 block 中的下标和创建时 block 的版本号；
+ * 在 block 之间移动、跳转和求下标都交给容器（is_first_block、is_last_block、next_block、prev_block、jump、index_of）。
+ */
+template<class Deque, class Node, bool Const>
+class block_iterator {
+private:
+    typedef typename Node::value_type value_type;
+    typedef typename std::conditional<Const, const Deque, Deque>::type host;
+    typedef typename std::conditional<Const, const value_type, value_type>::type element;
+    //指向 iterator 所在容器的指针
+    host *deq;
+    //当前元素在这个 chunk 上的 index
+    size_t cur_ind;
+    //指向这个 chunk 所在的结点
+    Node* node;
+    //node 的版本号，与 node->stamp 不同说明 iterator 已经失效
+    size_t stamp;
+    //iterator 解引用之前先让 block 独占存储空间（见 cow_pool），const_iterator 不需要
+    void touch(std::false_type) const { deq->unshare(node); }
+    void touch(std::true_type) const {}
+public:
+    block_iterator():deq(nullptr), cur_ind(0), node(nullptr), stamp(0) {}
+    block_iterator(host *host_deq, size_t ind, Node* cur_node):
+    deq(host_deq), cur_ind(ind), node(cur_node), stamp(cur_node == nullptr ? 0 : cur_node->stamp) {}
+    block_iterator(const block_iterator &other):
+    deq(other.deq), cur_ind(other.cur_ind), node(other.node), stamp(other.stamp) {}
+    block_iterator(const block_iterator<Deque, Node, !Const> &other):
+    deq(const_cast<host*>(other.deq)), cur_ind(other.cur_ind), node(other.node), stamp(other.stamp) {}
+    block_iterator &operator=(const block_iterator &other) = default;
+    /**
+     * return a new iterator which pointer n-next elements
+     * even if there are not enough elements, the behaviour is **undefined**.
+     * as well as operator-
+     * however if the iterator exceed only before begin(), or after end(),
+     * the program should still run **without causing an error**
+     * notice that n can be negative!!!
+     */
+    block_iterator operator+(const int &n) const {
+        block_iterator tmp(deq, cur_ind, node);
+        deq->jump(tmp.node, tmp.cur_ind, n);
+        tmp.stamp = tmp.node == nullptr ? 0 : tmp.node->stamp;
+        return tmp;
+    }
+    block_iterator operator-(const int &n) const {
+        return *this + (-n);
+    }
+    /**
+     *  return the signed distance between two iterator,
+     *  if these two iterators points to different vectors, throw invaild_iterator.
+     *  notice size_t is a very dangerous type which should mainly used by comparison
+     */
+    int operator-(const block_iterator &rhs) const {
+        if (deq != rhs.deq) throw invalid_iterator();
+        return int((long long)deq->index_of(node, cur_ind) - (long long)deq->index_of(rhs.node, rhs.cur_ind));
+    }
+    block_iterator& operator+=(const int &n) {
+        *this = *this + n;
+        return *this;
+    }
+    block_iterator& operator-=(const int &n) {
+        *this = *this + (-n);
+        return *this;
+    }
+    block_iterator operator++(int) {
+        block_iterator tmp(deq, cur_ind, node);
+        ++*this;
+        return tmp;
+    }
+    block_iterator& operator++() {
+        //node 为空说明容器被移动过，begin() 和 end() 都是 (nullptr, 0)
+        if (node == nullptr || cur_ind + 1 < node->length || deq->is_last_block(node)) {
+            cur_ind++;
+        } else {
+            cur_ind = 0;
+            node = deq->next_block(node);
+            stamp = node->stamp;
+        }
+        return *this;
+    }
+    block_iterator operator--(int) {
+        block_iterator tmp(deq, cur_ind, node);
+        --*this;
+        return tmp;
+    }
+    block_iterator& operator--() {
+        if (cur_ind == 0 && node != nullptr && !deq->is_first_block(node)) {
+            node = deq->prev_block(node);
+            cur_ind = node->length - 1;
+            stamp = node->stamp;
+        } else {
+            cur_ind--;
+        }
+        return *this;
+    }
+    /**
+     * throw invalid_iterator if the iterator does not point to an element.
+     */
+    element& operator*() const {
+        if (node == nullptr || cur_ind >= node->length) throw invalid_iterator();
+        touch(std::integral_constant<bool, Const>());
+        return *node->get(cur_ind);
+    }
+    element* operator->() const noexcept(Const || !Deque::shares_blocks::value) {
+        touch(std::integral_constant<bool, Const>());
+        return node->get(cur_ind);
+    }
+    /**
+     * a operator to check whether two iterators are same (pointing to the same memory).
+     */
+    bool operator==(const block_iterator<Deque, Node, false> &rhs) const {
+        return (node == rhs.node && cur_ind == rhs.cur_ind);
+    }
+    bool operator==(const block_iterator<Deque, Node, true> &rhs) const {
+        return (node == rhs.node && cur_ind == rhs.cur_ind);
+    }
+    bool operator!=(const block_iterator<Deque, Node, false> &rhs) const {
+        return !(*this == rhs);
+    }
+    bool operator!=(const block_iterator<Deque, Node, true> &rhs) const {
+        return !(*this == rhs);
+    }
+    friend Deque;
+    template<class, class, bool> friend class block_iterator;
+};
+/**
+ * deque 的结点：block_node 加上双向链表的指针、标号和在 block 目录中的位置
+ */
+template<class T, size_t ChunkSize>
+class list_node : public block_node<T, ChunkSize> {
+public:
+    list_node* prev;
+    list_node* next;
+    //chunk 的标号：沿链表严格递增（head 为 0，tail 为最大值），用来 O(1) 比较两个 block 的先后
+    //标号不要求连续，所以 spilt、merge 时不需要给后面所有的 block 重新编号
+    unsigned long long label;
+    //chunk 在 block 目录中的位置（从 1 开始）
+    size_t dir_pos;
+    //deque 的 finger 指向这个 block 时，它第一个元素的全局下标（见 deque::finger）
+    std::atomic<size_t> finger_base;
+    list_node():prev(nullptr), next(nullptr), label(0), dir_pos(0), finger_base(0) {}
+    //放回 spare_node 或缓存之前与链表断开
+    void clear_links() { prev = nullptr; }
+};
+template<class T, class Allocator = std::allocator<T>, class Pool = heap_pool, size_t ChunkSize = default_chunk_size<T>::value,
+         bool CheckIterators = true>
+class deque : private block_storage<T, Allocator, Pool, list_node<T, ChunkSize>> {
+public:
+    typedef list_node<T, ChunkSize> map_node;
+    typedef block_iterator<deque, map_node, false> iterator;
+    typedef block_iterator<deque, map_node, true> const_iterator;
+    //CheckIterators 为 false 时 insert、erase、split_at 不再检查传入的 iterator 是否合法，用于 release
+    static const bool check_iterator = CheckIterators;
+    //ChunkSize 为 adaptive_chunk_size 时每个 block 有自己的容量，chunk_size 是容量的上限
+    static const bool adaptive = ChunkSize == adaptive_chunk_size;
+    static const size_t chunk_size = adaptive ? max_adaptive_chunk_size : ChunkSize;
+    static_assert(adaptive || ChunkSize >= 4, "a block must hold at least 4 elements");
+private:
+    //deque 的参数：头（虚节点），尾（虚节点）和当前数据的个数
+    map_node* head;
+    map_node* tail;
+    size_t map_size;
+    //block 目录：dir[1..dir_size] 按顺序存放各个 block，fenwick 是以 block 长度为权值的树状数组
+    //链表结构改变（spilt、merge、删除 block）后目录失效，等到下一次随机访问时再重建
+    //const 的访问（at、operator[]、iterator 的加减）也可能重建目录，而它们可以在多个线程中同时进行：
+    //只有把 dir_building 从 false 改为 true 的线程重建，完成后以 release 写 dir_dirty = false，
+    //其他线程读到 dir_dirty 为 false 之后才读目录，在此之前沿链表线性查找，见 ensure_dir
+    //修改 deque 的操作本来就不能与其他访问同时进行，它们对 dir_dirty 的读写都是 relaxed 的
+    mutable map_node** dir;
+    mutable size_t* fenwick;
+    mutable size_t dir_size;
+    mutable size_t dir_cap;
+    mutable std::atomic<bool> dir_dirty;
+    mutable std::atomic<bool> dir_building;
+    //finger：上一次随机访问所在的 block，它第一个元素的全局下标记在 block 的 finger_base 中，附近的下标可以直接从这里找到
+    //非 const 的 at、operator[] 移动 finger 并计数，和 const 的访问一样可以在多个线程中同时进行：
+    //先写好新 block 的 finger_base，再以 release 写 finger，读到 finger 的线程（acquire）一定也读到正确的 finger_base；
+    //同时进行的访问写入的 finger_base 都是同一个值，没有访问在进行时只有修改操作维护 finger 的 finger_base
+    //计数只是统计，用 relaxed 的读和写而不是原子加，多个线程同时访问时可能少计几次
+    std::atomic<map_node*> finger;
+    std::atomic<size_t> finger_hit;
+    std::atomic<size_t> finger_miss;
+    //spare_node、block 缓存、map_node 组、upstream 和 pool 都在 block_storage 中
+    typedef block_storage<T, Allocator, Pool, map_node> storage;
+    typedef typename storage::alloc_traits alloc_traits;
+    using storage::spare_node;
+    using storage::cached_block;
+    using storage::cached_blocks;
+    using storage::cache_limit;
+    using storage::up;
+    using storage::pool;
+    using storage::new_node;
+    using storage::new_block;
+    using storage::destroy_elements;
+    using storage::drop_node;
+    using storage::delete_block;
+    using storage::cache_block;
+    typedef typename storage::shares_blocks shares_blocks;
+    using storage::is_shared;
+    using storage::release_shared;
+    using storage::unshare;
+    using storage::reset_block;
+    using storage::copy_block;
+    using storage::give_nodes;
+    using storage::take_nodes;
+    using storage::hand_over;
+    using storage::release_storage;
+    using storage::swap_storage;
+    using storage::assign_alloc;
+    using storage::swap_alloc;
+    template<class, class, bool> friend class block_iterator;
+public:
+    using storage::get_allocator;
+    using storage::block_cache_limit;
+    using storage::set_block_cache_limit;
+private:
+    //新 block 的容量：非自适应时总是 chunk_size；自适应时取不小于 sqrt(size()) 且能放下 need 个元素的最小的 2 的幂
+    size_t new_capacity(size_t need) const {
+        if (!adaptive) return chunk_size;
+        size_t cap = min_chunk_size;
+        while (cap < chunk_size && (cap * cap < map_size || cap <= need)) cap <<= 1;
+        return cap;
+    }
+    //申请 head 和 tail 两个虚节点，失败时 head 保持为 nullptr
+    void init_sentinel() {
+        map_node* first = new_node();
+        try {
+            tail = new_node();
+        } catch (...) {
+            drop_node(first);
+            throw;
+        }
+        head = first;
+        head->label = 0;
+        tail->label = ~0ULL;
+        head->next = tail;
+        tail->prev = head;
+    }
+    //被移动过的 deque 不占用任何内存（head 为 nullptr），直到下一次需要链表时才申请虚节点和一个空 block
+    void ensure_list() {
+        if (head != nullptr) return;
+        map_node* block = new_block(new_capacity(0));
+        try {
+            init_sentinel();
+        } catch (...) {
+            delete_block(block);
+            throw;
+        }
+        init_list(block);
+    }
+    //析构所有元素、释放所有 block 和目录，回到被移动过的状态，不会申请内存
+    void make_hollow() {
+        if (head == nullptr) return;
+        destroy_list();
+        drop_node(head);
+        drop_node(tail);
+        head = tail = nullptr;
+        map_size = 0;
+        free_dir();
+        finger.store(nullptr, std::memory_order_relaxed);
+    }
+    //pos 是被移动过的 deque 自己的 begin() 或 end() 时，申请链表以后换成新的 end()
+    void ensure_list(iterator &pos) {
+        if (head != nullptr) return;
+        ensure_list();
+        if (pos.deq == this && pos.node == nullptr) pos = end();
+    }
+    //交换除分配器以外的全部内容，block 链表、目录和 pool 都只交换指针，O(1)
+    void swap_data(deque &other) {
+        std::swap(head, other.head);
+        std::swap(tail, other.tail);
+        std::swap(map_size, other.map_size);
+        std::swap(dir, other.dir);
+        std::swap(fenwick, other.fenwick);
+        std::swap(dir_size, other.dir_size);
+        std::swap(dir_cap, other.dir_cap);
+        bool dirty = dir_dirty.load(std::memory_order_relaxed);
+        dir_dirty.store(other.dir_dirty.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        other.dir_dirty.store(dirty, std::memory_order_relaxed);
+        map_node* f = finger.load(std::memory_order_relaxed);
+        finger.store(other.finger.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        other.finger.store(f, std::memory_order_relaxed);
+        size_t hit = finger_hit.load(std::memory_order_relaxed), miss = finger_miss.load(std::memory_order_relaxed);
+        finger_hit.store(other.finger_hit.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        finger_miss.store(other.finger_miss.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        other.finger_hit.store(hit, std::memory_order_relaxed);
+        other.finger_miss.store(miss, std::memory_order_relaxed);
+        swap_storage(other);
+    }
+    //在 block 的第 ind 个位置原地构造新元素，构造抛出异常时把空出来的位置收回
+    template<class... Args>
+    void construct_in(map_node* block, size_t ind, Args&&... args) {
+        unshare(block);
+        T* slot = block->make_room(ind);
+        try {
+            alloc_traits::construct(up.alloc, slot, std::forward<Args>(args)...);
+        } catch (...) {
+            block->remove(ind);
+            throw;
+        }
+    }
+    //在 block 末尾的空位上逐个构造 [first, last) 中的元素，直到 block 只剩一个空位或者元素用完
+    //length 和 map_size 跟着增加，构造抛出异常时 block 仍然是完整的
+    template<class InputIt>
+    void fill_block(map_node* block, InputIt &first, InputIt last) {
+        unshare(block);
+        for (; first != last && block->length + 1 < block->capacity(); ++first) {
+            alloc_traits::construct(up.alloc, block->get(block->length), *first);
+            block->length++;
+            map_size++;
+        }
+    }
+    //在 after 后面链入一个新的空 block
+    map_node* link_block(map_node* after) {
+        map_node* block = new_block(new_capacity(0));
+        block->prev = after;
+        block->next = after->next;
+        after->next->prev = block;
+        after->next = block;
+        assign_label(block);
+        return block;
+    }
+    //把 [first, last) 接到末尾：先填满最后一个 block，再一个一个地申请新 block 填满并追加进目录
+    //每个 block 只在填完以后更新一次树状数组
+    template<class InputIt>
+    void append_range(InputIt first, InputIt last) {
+        ensure_list();
+        map_node* block = tail->prev;
+        size_t old_length = block->length;
+        try {
+            fill_block(block, first, last);
+            while (first != last) {
+                update_length(block, block->length - old_length);
+                old_length = block->length;
+                map_node* next = link_block(block);
+                dir_push_back(next);
+                block = next;
+                old_length = 0;
+                fill_block(block, first, last);
             }
-            return *this;
-        }
-        /**
-         * TODO *it
-         * throw invalid_iterator
-         */
-        T& operator*() const {
-            if (cur == nullptr || cur->data == nullptr) throw invalid_iterator();
-            return *cur->data;
-        }
-        /**
-         * TODO it->field
-         */
-        T* operator->() const noexcept { return cur->data; }
-        /**
-         * a operator to check whether two iterators are same (pointing to the same memory).
-         */
-        bool operator==(const iterator &rhs) const {
-            return (cur == rhs.cur);
-        }
-        bool operator==(const const_iterator &rhs) const {
-            return (cur == rhs.cur);
-        }
-        /**
-         * some other operator for iterator.
-         */
-        bool operator!=(const iterator &rhs) const {
-            return (cur != rhs.cur);
-        }
-        bool operator!=(const const_iterator &rhs) const {
-            return (cur != rhs.cur);
-        }
-    friend class deque<T>;
-    friend class const_iterator;
-    };
-    class const_iterator {
-        /** it should has similar member method as iterator.
-         * and it should be able to construct from an iterator.
-         */
-    private:
-        //指向常量的指针不能改变常量到地址中存放的数据，但是可以改变指向哪个常量
-        const deque<T> *deq;
-        chunk_node* cur;
-        size_t cur_ind;
-        map_node* node;        
-    public:
-        const_iterator():deq(nullptr), cur(nullptr), cur_ind(0), node(nullptr) {}
-        const_iterator(const deque<T> *host_deq, chunk_node* current,
-                       size_t ind, map_node* cur_node):
-        deq(host_deq), cur(current), cur_ind(ind), node(cur_node) {}
-        const_iterator(const const_iterator &other):
-        deq(other.deq), cur(other.cur), cur_ind(other.cur_ind), node(other.node) {}
-        const_iterator(const iterator &other):
-        deq(other.deq), cur(other.cur), cur_ind(other.cur_ind), node(other.node) {}
-        const_iterator operator+(const int &n) const {
-            if (n > 0) {
-                int n_tmp = n;
-                const_iterator tmp(deq, cur, cur_ind, node);
-                while (tmp.node->next != deq->tail && tmp.cur_ind + n_tmp >= tmp.node->length) {
-                    n_tmp -= tmp.node->length - tmp.cur_ind;
-                    tmp.node = tmp.node->next;
-                    tmp.cur = tmp.node->fir_node;
-                    tmp.cur_ind = 0;
-                }
-                while (n_tmp--) {
-                    tmp.cur = tmp.cur->next;
-                    tmp.cur_ind++;
-                }
-                return tmp;
-            } else if (n < 0) {
-            int n_tmp = -n;
-                const_iterator tmp(deq, cur, cur_ind, node);
-                while (tmp.cur_ind < n_tmp && tmp.node->prev != tmp.deq->head) {
-                    n_tmp -= tmp.cur_ind + 1;
-                    tmp.node = tmp.node->prev;
-                    tmp.cur = tmp.node->las_node;
-                    tmp.cur = tmp.cur->prev;
-                    tmp.cur_ind = tmp.node->length - 1;
-                }
-                while (n_tmp--) {
-                    tmp.cur = tmp.cur->prev;
-                    tmp.cur_ind--;
+        } catch (...) {
+            update_length(block, block->length - old_length);
+            //刚链入的 block 中一个元素也没有构造成功，不能留在末尾
+            if (block->length == 0 && block->prev != head) remove_block(block);
+            throw;
+        }
+        update_length(block, block->length - old_length);
+    }
+    //在 pos 前插入 [first, last)：把 pos 所在的 block 从 pos 处 spilt 一次，新元素接在前半部分的末尾，
+    //放不下时在中间链入新的 block，最后只检查被切出来的后半部分要不要合并，O(插入个数 + chunk_size)
+    //构造抛出异常时已经插入的元素保留，链表中间不会留下空的 block
+    template<class InputIt>
+    iterator insert_range(iterator pos, InputIt first, InputIt last) {
+        ensure_list(pos);
+        if (check_iterator && iterator_not_exist(pos)) throw invalid_iterator();
+        if (first == last) return pos;
+        map_node* block = pos.node;
+        size_t ind = pos.cur_ind;
+        if (block->next == tail && ind == block->length) {
+            append_range(first, last);
+        } else {
+            spilt(block, ind);
+            map_node* rest = block->next;
+            //中间链入的 block 不在目录里，等下一次随机访问时重建
+            dir_dirty.store(true, std::memory_order_relaxed);
+            finger.store(nullptr, std::memory_order_relaxed);
+            map_node* cur = block;
+            try {
+                fill_block(cur, first, last);
+                while (first != last) {
+                    cur = link_block(cur);
+                    fill_block(cur, first, last);
                 }
-                return tmp;
-            } else {
-                return *this;
+            } catch (...) {
+                //最后链入的 block 和切出来的后半部分都可能是空的，pos 在 block 开头时 block 本身也可能是空的
+                if (cur != block && cur->length == 0) remove_block(cur);
+                size_t tmp_ind = 0;
+                maintainBlock(rest, tmp_ind);
+                if (block->length == 0) maintainBlock(block, tmp_ind);
+                throw;
             }
+            size_t rest_ind = 0;
+            maintainBlock(rest, rest_ind);
         }
-        const_iterator operator-(const int &n) const {
-            if (n < 0) {
-                int n_tmp = -n;
-                const_iterator tmp(deq, cur, cur_ind, node);
-                while (tmp.node->next != deq->tail && tmp.cur_ind + n_tmp >= tmp.node->length) {
-                    n_tmp -= tmp.node->length - tmp.cur_ind;
-                    tmp.node = tmp.node->next;
-                    tmp.cur = tmp.node->fir_node;
-                    tmp.cur_ind = 0;
-                }
-                while (n_tmp--) {
-                    tmp.cur = tmp.cur->next;
-                    tmp.cur_ind++;
-                }
-                return tmp;
-            } else if (n > 0) {
-            int n_tmp = n;
-                const_iterator tmp(deq, cur, cur_ind, node);
-                while (tmp.cur_ind < n_tmp && tmp.node->prev != tmp.deq->head) {
-                    n_tmp -= tmp.cur_ind + 1;
-                    tmp.node = tmp.node->prev;
-                    tmp.cur = tmp.node->las_node;
-                    tmp.cur = tmp.cur->prev;
-                    tmp.cur_ind = tmp.node->length - 1;
-                }
-                while (n_tmp--) {
-                    tmp.cur = tmp.cur->prev;
-                    tmp.cur_ind--;
+        //block 原来就已经满了的话，第一个新元素在下一个 block 的开头
+        if (ind == block->length) {
+            block = block->next;
+            ind = 0;
+        }
+        return iterator(this, ind, block);
+    }
+    //把 block 中不满足 pred 的元素按原来的顺序紧缩到前面，满足的析构掉，返回删除的个数
+    //pred 抛出异常时，把还没有检查的元素接在保留下来的元素后面，block 仍然是完整的
+    template<class Pred>
+    size_t compact_block(map_node* block, Pred &pred) {
+        unshare(block);
+        size_t w = 0, i = 0;
+        try {
+            for (; i < block->length; ++i) {
+                T* ptr = block->get(i);
+                if (pred(*ptr)) {
+                    alloc_traits::destroy(up.alloc, ptr);
+                } else {
+                    if (w != i) map_node::relocate(block->get(w), ptr);
+                    w++;
                 }
-                return tmp;
-            } else {
-                return *this;
             }
+        } catch (...) {
+            size_t removed = i - w;
+            for (; i < block->length; ++i, ++w) {
+                if (w != i) map_node::relocate(block->get(w), block->get(i));
+            }
+            finish_compact(block, removed);
+            throw;
         }
-        // return the distance between two iterator,
-        // if these two iterators points to different vectors, throw invaild_iterator.
-        int operator-(const const_iterator &rhs) const {
-            if (deq != rhs.deq) throw invalid_iterator();
-            int tmp = 0;
-            const_iterator tmp_it = *this;
-            if (node->index > rhs.node->index) {
-                map_node* tmp_node = rhs.node;
-                tmp += rhs.node->length - rhs.cur_ind;
-                tmp_node = tmp_node->next;
-                while (tmp_node->index < node->index) {
-                    tmp += tmp_node->length;
-                    tmp_node = tmp_node->next;
-                }
-                tmp += cur_ind;
-            } else if (node->index < rhs.node->index) {
-                map_node* tmp_node = node;
-                tmp -= node->length - cur_ind;
-                tmp_node = tmp_node->next;
-                while (tmp_node->index < rhs.node->index) {
-                    tmp -= tmp_node->length;
-                    tmp_node = tmp_node->next;
+        size_t removed = i - w;
+        finish_compact(block, removed);
+        return removed;
+    }
+    void finish_compact(map_node* block, size_t removed) {
+        if (removed == 0) return;
+        block->length -= removed;
+        block->stamp++;
+        map_size -= removed;
+        if (block->length == 0 && !(block->prev == head && block->next == tail)) remove_block(block);
+    }
+    //把所有 block 均匀地重新标号，用于整个链表重新建立之后，O(#blocks)
+    void relabel_all() {
+        size_t cnt = 0;
+        for (map_node* ptr = head->next; ptr != tail; ptr = ptr->next) cnt++;
+        unsigned long long gap = ~0ULL / (cnt + 1), label = 0;
+        for (map_node* ptr = head->next; ptr != tail; ptr = ptr->next) {
+            label += gap;
+            ptr->label = label;
+        }
+    }
+    //把 other 中从 first 开始到 last 之前的 block 按顺序接到自己的 before 后面，nodes 是用 take_nodes 事先取好的 map_node，不会抛出异常
+    //head、tail 和 map_node 都留在原来的 deque 中（见 hand_over），所以要逐个 block 交出存储空间，O(#blocks moved)
+    //接进来的 block 逐个用 assign_label 标号（均摊 O(log #blocks)），其余的 block 不用重新标号
+    //接在末尾时自己的目录和 finger 仍然有效，新 block 由调用者追加进目录；接在别处时两者都失效
+    //other 拿走的是末尾的一段时只截掉目录的末尾，finger 不在这一段中就仍然有效
+    void move_blocks(deque &other, map_node* first, map_node* last, map_node* before, map_node* nodes) {
+        if (last == other.tail && !other.dir_dirty.load(std::memory_order_relaxed) && other.in_dir(first)) {
+            other.dir_size = first->dir_pos - 1;
+        } else {
+            other.dir_dirty.store(true, std::memory_order_relaxed);
+        }
+        map_node* f = other.finger.load(std::memory_order_relaxed);
+        if (f != nullptr && (last != other.tail || f->label >= first->label)) other.finger.store(nullptr, std::memory_order_relaxed);
+        map_node* after = before->next;
+        if (after != tail) {
+            dir_dirty.store(true, std::memory_order_relaxed);
+            finger.store(nullptr, std::memory_order_relaxed);
+        }
+        first->prev->next = last;
+        last->prev = first->prev;
+        while (first != last) {
+            map_node* block = first;
+            first = first->next;
+            map_node* node = nodes;
+            nodes = nodes->next;
+            map_size += block->length;
+            other.map_size -= block->length;
+            hand_over(other, block, node);
+            node->prev = before;
+            node->next = after;
+            before->next = node;
+            after->prev = node;
+            assign_label(node);
+            before = node;
+        }
+    }
+    //把 other 的所有 block 接到末尾（front 为 true 时接到开头），接头处最多合并一次，other 变为空
+    void splice_list(deque &other, bool front) {
+        if (this == &other || other.map_size == 0) return;
+        ensure_list();
+        if (!Pool::transferable || !(up.alloc == other.up.alloc)) {
+            //只能逐个移动元素
+            if (front) {
+                iterator it = other.end();
+                while (it != other.begin()) {
+                    --it;
+                    emplace_front(std::move(*it));
                 }
-                tmp -= rhs.cur_ind;
             } else {
-                tmp = int(cur_ind) - int(rhs.cur_ind);
+                for (iterator it = other.begin(); it != other.end(); ++it) emplace_back(std::move(*it));
             }
-            return tmp;
-        }
-        const_iterator& operator+=(const int &n) {
-            if (n > 0) {
-                int n_tmp = n;
-                while (node->next != deq->tail && cur_ind + n_tmp >= node->length) {
-                    n_tmp -= node->length - cur_ind;
-                    node = node->next;
-                    cur = node->fir_node;
-                    cur_ind = 0;
-                }
-                while (n_tmp--) {
-                    cur = cur->next;
-                    cur_ind++;
-                }
-            } else if (n < 0) {
-                int n_tmp = -n;
-                while (cur_ind < n_tmp && node->prev != deq->head) {
-                    n_tmp -= cur_ind + 1;
-                    node = node->prev;
-                    cur = node->las_node;
-                    cur = cur->prev;
-                    cur_ind = node->length - 1;
-                }
-                while (n_tmp--) {
-                    cur = cur->prev;
-                    cur_ind--;
+            other.clear();
+            return;
+        }
+        //先准备好所有要用的内存：自己接住 other 的 block 用的 map_node，other 之后剩下的那个空 block
+        size_t count = 0;
+        for (map_node* ptr = other.head->next; ptr != other.tail; ptr = ptr->next) count++;
+        map_node* nodes = take_nodes(count);
+        map_node* empty;
+        try {
+            empty = other.new_block(adaptive ? min_chunk_size : chunk_size);
+        } catch (...) {
+            give_nodes(nodes);
+            throw;
+        }
+        //自己为空时先去掉唯一的空 block
+        if (map_size == 0) {
+            map_node* block = head->next;
+            dir_erase(block);
+            head->next = tail;
+            tail->prev = head;
+            cache_block(block);
+        }
+        map_node* before = front ? head : tail->prev;
+        map_node* after = before->next;
+        move_blocks(other, other.head->next, other.tail, before, nodes);
+        other.init_list(empty);
+        other.free_dir();
+        //接头处的两个 block 太短时合并
+        map_node* left = front ? after->prev : before;
+        if (left != head && left->next != tail && left->length + left->next->length <= (left->capacity() >> 1)) {
+            merge(left, left->next);
+        }
+        //接在末尾（包括自己原来为空）的 block 在合并之后再追加进目录，O(log #blocks) 每个
+        if (after == tail) {
+            for (map_node* ptr = before->next; ptr != tail; ptr = ptr->next) dir_push_back(ptr);
+        }
+    }
+    //建立只含一个空 block 的链表
+    void init_list() {
+        init_list(new_block(new_capacity(0)));
+    }
+    void init_list(map_node* block) {
+        block->next = tail;
+        block->prev = head;
+        head->next = block;
+        tail->prev = block;
+        assign_label(block);
+    }
+    //释放 head 和 tail 之间的所有 block
+    void destroy_list() {
+        if (head == nullptr) return;
+        map_node* ptr = head->next;
+        while (ptr != tail) {
+            ptr = ptr->next;
+            delete_block(ptr->prev);
+        }
+        head->next = tail;
+        tail->prev = head;
+        dir_dirty.store(true, std::memory_order_relaxed);
+        finger.store(nullptr, std::memory_order_relaxed);
+    }
+    //把 other 的内容按 block 复制过来：已有的 block 按顺序直接复用，不够时再申请，多出来的释放
+    //过程中链表始终是完整的，复制抛出异常时 deque 仍然可以正常使用和析构
+    void assign_list(const deque &other) {
+        if (other.head == nullptr) {
+            clear();
+            return;
+        }
+        ensure_list();
+        dir_dirty.store(true, std::memory_order_relaxed);
+        finger.store(nullptr, std::memory_order_relaxed);
+        if (Pool::shares_blocks && up.alloc == other.up.alloc) {
+            share_list(other, shares_blocks());
+            return;
+        }
+        map_node* last = head;
+        try {
+            for (map_node* other_ptr = other.head->next; other_ptr != other.tail; other_ptr = other_ptr->next) {
+                map_node* block = last->next;
+                if (block == tail) {
+                    block = new_block(other_ptr->capacity());
+                    block->prev = last;
+                    block->next = tail;
+                    last->next = block;
+                    tail->prev = block;
+                } else {
+                    map_size -= block->length;
+                    reset_block(block);
+                    //自适应 block 大小时复用的 block 可能放不下，换一块和 other 一样大的存储空间
+                    //先申请新的再释放旧的，申请失败时 block 仍然是完整的（空）block
+                    if (block->capacity() < other_ptr->capacity()) {
+                        T* data = static_cast<T*>(pool.allocate(up, sizeof(T) * other_ptr->capacity()));
+                        pool.deallocate(up, block->data, sizeof(T) * block->capacity());
+                        block->data = data;
+                        block->cap = other_ptr->capacity();
+                    }
                 }
+                block->label = other_ptr->label;
+                copy_block(block, other_ptr, map_size, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+                last = block;
             }
-            return *this;
-        }
-        const_iterator& operator-=(const int &n) {
-            if (n < 0) {
-                int n_tmp = -n;
-                while (node->next != deq->tail && cur_ind + n_tmp >= node->length) {
-                    n_tmp -= node->length - cur_ind;
-                    node = node->next;
-                    cur = node->fir_node;
-                    cur_ind = 0;
-                }
-                while (n_tmp--) {
-                    cur = cur->next;
-                    cur_ind++;
-                }
-            } else if (n > 0) {
-                int n_tmp = n;
-                while (cur_ind < n_tmp && node->prev != deq->head) {
-                    n_tmp -= cur_ind + 1;
+        } catch (...) {
+            //复制到一半失败：删掉空了的 block（至少保留一个），已经复制的 block 用的是 other 的标号，全部重新标号
+            for (map_node* ptr = head->next; ptr != tail;) {
+                map_node* next = ptr->next;
+                if (ptr->length == 0 && !(ptr->prev == head && next == tail)) remove_block(ptr);
+                ptr = next;
+            }
+            relabel_all();
+            throw;
+        }
+        while (last->next != tail) {
+            map_node* block = last->next;
+            last->next = block->next;
+            block->next->prev = last;
+            map_size -= block->length;
+            delete_block(block);
+        }
+    }
+    //cow_pool 下不复制元素，只共享 other 的每个 block，O(#blocks)
+    //共享的 block 先接在原有 block 的后面，全部接好后再删掉原有的 block，出现异常时链表仍然是完整的
+    void share_list(const deque &other, std::true_type) {
+        map_node* old_last = tail->prev;
+        try {
+            for (map_node* other_ptr = other.head->next; other_ptr != other.tail; other_ptr = other_ptr->next) {
+                map_node* block = new_node();
+                Pool::share(other_ptr->data);
+                block->data = other_ptr->data;
+                block->start = other_ptr->start;
+                block->cap = other_ptr->cap;
+                block->length = other_ptr->length;
+                block->prev = tail->prev;
+                block->next = tail;
+                tail->prev->next = block;
+                tail->prev = block;
+                map_size += block->length;
+            }
+        } catch (...) {
+            relabel_all();
+            throw;
+        }
+        map_node* first_new = old_last->next;
+        while (head->next != first_new) {
+            map_node* block = head->next;
+            head->next = block->next;
+            block->next->prev = head;
+            map_size -= block->length;
+            delete_block(block);
+        }
+        relabel_all();
+    }
+    void share_list(const deque &, std::false_type) {}
+    void free_dir() const {
+        if (dir_cap == 0) return;
+        up.deallocate(dir, sizeof(map_node*) * dir_cap);
+        up.deallocate(fenwick, sizeof(size_t) * dir_cap);
+        dir = nullptr;
+        fenwick = nullptr;
+        dir_cap = 0;
+        dir_size = 0;
+        dir_dirty.store(true, std::memory_order_relaxed);
+    }
+    //按链表顺序重建 block 目录和树状数组，O(#blocks)
+    void rebuild_dir() const {
+        size_t cnt = 0;
+        for (map_node* ptr = head->next; ptr != tail; ptr = ptr->next) cnt++;
+        if (cnt + 1 > dir_cap) {
+            //两块都申请成功以后再换掉旧的目录，失败时目录保持原样（仍然是失效的）
+            size_t cap = (cnt + 1) << 1;
+            map_node** new_dir = static_cast<map_node**>(up.allocate(sizeof(map_node*) * cap));
+            size_t* new_fenwick;
+            try {
+                new_fenwick = static_cast<size_t*>(up.allocate(sizeof(size_t) * cap));
+            } catch (...) {
+                up.deallocate(new_dir, sizeof(map_node*) * cap);
+                throw;
+            }
+            free_dir();
+            dir = new_dir;
+            fenwick = new_fenwick;
+            dir_cap = cap;
+        }
+        size_t i = 0;
+        for (map_node* ptr = head->next; ptr != tail; ptr = ptr->next) {
+            ++i;
+            dir[i] = ptr;
+            ptr->dir_pos = i;
+            fenwick[i] = ptr->length;
+        }
+        //线性建树：每个结点把自己的值加到父结点上
+        for (i = 1; i <= cnt; ++i) {
+            size_t j = i + (i & -i);
+            if (j <= cnt) fenwick[j] += fenwick[i];
+        }
+        dir_size = cnt;
+        dir_dirty.store(false, std::memory_order_release);
+    }
+    //目录有效（或者由当前线程重建完成）时返回 true；另一个线程正在重建时返回 false，调用者应沿链表查找
+    bool ensure_dir() const {
+        if (!dir_dirty.load(std::memory_order_acquire)) return true;
+        bool building = false;
+        if (!dir_building.compare_exchange_strong(building, true, std::memory_order_acquire, std::memory_order_relaxed)) return false;
+        //rebuild_dir 申请内存失败时也要放开 dir_building，否则以后的查找都只能沿链表进行
+        try {
+            if (dir_dirty.load(std::memory_order_relaxed)) rebuild_dir();
+        } catch (...) {
+            dir_building.store(false, std::memory_order_release);
+            throw;
+        }
+        dir_building.store(false, std::memory_order_release);
+        return true;
+    }
+    //前 i 个 block 的元素个数之和
+    size_t prefix_length(size_t i) const {
+        size_t sum = 0;
+        for (; i > 0; i -= i & -i) sum += fenwick[i];
+        return sum;
+    }
+    //block 的长度改变了 delta（可以是"负数"，依赖无符号数的回绕）
+    void fenwick_add(map_node* block, size_t delta) {
+        if (dir_dirty.load(std::memory_order_relaxed)) return;
+        for (size_t i = block->dir_pos; i <= dir_size; i += i & -i) fenwick[i] += delta;
+    }
+    //在目录末尾追加一个 block（用于 push_back 时末尾 block 的 spilt），O(log #blocks)
+    void dir_push_back(map_node* block) {
+        if (dir_dirty.load(std::memory_order_relaxed)) return;
+        if (dir_size + 2 > dir_cap) {
+            dir_dirty.store(true, std::memory_order_relaxed);
+            return;
+        }
+        size_t i = ++dir_size;
+        dir[i] = block;
+        block->dir_pos = i;
+        fenwick[i] = block->length + prefix_length(i - 1) - prefix_length(i - (i & -i));
+    }
+    //block 中增加或删除了元素（delta 为 1 或 size_t(-1)），更新树状数组和 finger
+    void update_length(map_node* block, size_t delta) {
+        fenwick_add(block, delta);
+        map_node* f = finger.load(std::memory_order_relaxed);
+        if (f != nullptr && block->label < f->label) f->finger_base.store(f->finger_base.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+    //目录有效时 block 是否在目录中：目录之外的结点（包括已经删除的）不会出现在 dir[1..dir_size] 中
+    bool in_dir(map_node* block) const {
+        return block->dir_pos != 0 && block->dir_pos <= dir_size && dir[block->dir_pos] == block;
+    }
+    //block 将要从链表中删除：如果它是目录中的最后一个就直接截掉，在目录中间就让目录失效
+    //还没有追加进目录的 block（splice_list 刚接在末尾的）不影响目录
+    void dir_erase(map_node* block) {
+        if (finger.load(std::memory_order_relaxed) == block) finger.store(nullptr, std::memory_order_relaxed);
+        if (dir_dirty.load(std::memory_order_relaxed)) return;
+        if (block->dir_pos == dir_size && dir[dir_size] == block) dir_size--;
+        else if (in_dir(block)) dir_dirty.store(true, std::memory_order_relaxed);
+    }
+    //找到第 pos 个元素所在的 block 和它第一个元素的全局下标 base，hit 表示是否由 finger 找到；不修改 finger
+    //pos 落在 finger 或与它相邻的 block 中时为 O(1)，否则通过目录查找，O(log #blocks)
+    map_node* find_block(size_t pos, size_t &base, bool &hit) const {
+        hit = true;
+        //相邻 block 的长度不超过 chunk_size，离 finger 太远的下标不必再去读相邻的 block
+        map_node* node = finger.load(std::memory_order_acquire);
+        if (node != nullptr) base = node->finger_base.load(std::memory_order_relaxed);
+        if (node != nullptr && pos + chunk_size >= base && pos < base + node->length + chunk_size) {
+            if (pos < base) {
+                if (node->prev != head && base - pos <= node->prev->length) {
                     node = node->prev;
-                    cur = node->las_node;
-                    cur = cur->prev;
-                    cur_ind = node->length - 1;
+                    base -= node->length;
+                    return node;
                 }
-                while (n_tmp--) {
-                    cur = cur->prev;
-                    cur_ind--;
-                }
-            }
-            return *this;
-        }
-        /**
-         * TODO iter++
-         */
-        const_iterator operator++(int) {
-            const_iterator tmp(deq, cur, cur_ind, node);
-            if (cur_ind + 1 < node->length || (cur_ind + 1 >= node->length && node->next == deq->tail)) {
-                cur_ind++;
-                cur = cur->next;
-            } else {
-                cur_ind = 0;
-                node = node->next;
-                cur = node->fir_node;
+            } else if (pos - base < node->length) {
+                return node;
+            } else if (node->next != tail && pos - base - node->length < node->next->length) {
+                base += node->length;
+                return node->next;
             }
-            return tmp;
-        }
-        /**
-         * TODO ++iter
-         */
-        const_iterator& operator++() {
-            if (cur_ind + 1 < node->length || (cur_ind + 1 >= node->length && node->next == deq->tail)) {
-                cur_ind++;
-                cur = cur->next;
-            } else {
-                cur_ind = 0;
+        }
+        hit = false;
+        base = 0;
+        if (!ensure_dir()) {
+            node = head->next;
+            while (pos - base >= node->length) {
+                base += node->length;
                 node = node->next;
-                cur = node->fir_node;
             }
-            return *this;
-        }
-        /**
-         * TODO iter--
-         */
-        const_iterator operator--(int) {
-            const_iterator tmp(deq, cur, cur_ind, node);
-            if (cur_ind < 1 && node->prev != deq->head) {
-                node = node->prev;
-                cur_ind = node->length - 1;
-                cur = node->las_node->prev;
-            } else {
-                cur_ind--;
-                cur = cur->prev;
+            return node;
+        }
+        size_t step = 1;
+        while ((step << 1) <= dir_size) step <<= 1;
+        size_t ind = 0;
+        for (; step > 0; step >>= 1) {
+            if (ind + step <= dir_size && fenwick[ind + step] <= pos - base) {
+                ind += step;
+                base += fenwick[ind];
             }
-            return tmp;
-        }
-        /**
-         * TODO --iter
-         */
-        const_iterator& operator--() {
-            if (cur_ind < 1 && node->prev != deq->head) {
-                node = node->prev;
-                cur_ind = node->length - 1;
-                cur = node->las_node->prev;
-            } else {
-                cur_ind--;
-                cur = cur->prev;
+        }
+        return dir[ind + 1];
+    }
+    //找到第 pos 个元素所在的 block，并把 pos 改为它在 block 中的下标；非 const 的访问同时把 finger 移到这个 block
+    map_node* locate(size_t &pos) {
+        size_t base;
+        bool hit;
+        map_node* node = find_block(pos, base, hit);
+        std::atomic<size_t> &counter = hit ? finger_hit : finger_miss;
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (finger.load(std::memory_order_relaxed) != node) {
+            node->finger_base.store(base, std::memory_order_relaxed);
+            finger.store(node, std::memory_order_release);
+        }
+        pos -= base;
+        return node;
+    }
+    map_node* locate(size_t &pos) const {
+        size_t base;
+        bool hit;
+        map_node* node = find_block(pos, base, hit);
+        pos -= base;
+        return node;
+    }
+    //(block, ind) 的全局下标：block 之前的元素个数由目录求出，O(log #blocks)
+    //已经被删除的 block 不在目录中，说明 iterator 已经失效
+    size_t index_of(map_node* block, size_t ind) const {
+        if (head == nullptr) return ind;
+        map_node* f = finger.load(std::memory_order_acquire);
+        if (block == f) return f->finger_base.load(std::memory_order_relaxed) + ind;
+        if (!ensure_dir()) {
+            size_t base = 0;
+            for (map_node* ptr = head->next; ptr != tail; ptr = ptr->next) {
+                if (ptr == block) return base + ind;
+                base += ptr->length;
             }
-            return *this;
-        }
-        /**
-         * TODO *it
-         * remember to throw
-         */
-        const T& operator*() const {
-            if (cur == nullptr || cur->data == nullptr) throw invalid_iterator();
-            return *cur->data;
-        }
-        /**
-         * TODO it->field
-         */
-        const T* operator->() const noexcept { return cur->data; }
-        /**
-         * a operator to check whether two iterators are same (pointing to the same memory).
-         */
-        bool operator==(const iterator &rhs) const {
-            return (cur == rhs.cur);
-        }
-        bool operator==(const const_iterator &rhs) const {
-            return (cur == rhs.cur);
-        }
-        /**
-         * some other operator for iterator.
-         */
-        bool operator!=(const iterator &rhs) const {
-            return (cur != rhs.cur);
-        }
-        bool operator!=(const const_iterator &rhs) const {
-            return (cur != rhs.cur);
-        }
-    friend class deque<T>;
-    friend class iterator;
-    };
+            throw invalid_iterator();
+        }
+        if (!in_dir(block)) throw invalid_iterator();
+        return prefix_length(block->dir_pos - 1) + ind;
+    }
+    //iterator 在 block 之间移动时用到
+    bool is_first_block(map_node* block) const { return block->prev == head; }
+    bool is_last_block(map_node* block) const { return block->next == tail; }
+    static map_node* next_block(map_node* block) { return block->next; }
+    static map_node* prev_block(map_node* block) { return block->prev; }
+    //把 (block, ind) 向后移动 n 个元素（n 可以为负）：目标在当前 block 内时直接移动，否则由目录定位，O(log #blocks)
+    //越过 begin() 或 end() 时停在第一个或最后一个 block 上，下标越界但不会出错
+    void jump(map_node* &block, size_t &ind, long long n) const {
+        if (head == nullptr) {
+            ind += n;
+            return;
+        }
+        if (n >= 0 ? ind + size_t(n) < block->length : size_t(-n) <= ind) {
+            ind += n;
+            return;
+        }
+        long long target = (long long)index_of(block, ind) + n;
+        if (target < 0) {
+            block = head->next;
+            ind = size_t(target);
+        } else if (size_t(target) >= map_size) {
+            block = tail->prev;
+            ind = size_t(target) - (map_size - block->length);
+        } else {
+            size_t pos = size_t(target);
+            block = locate(pos);
+            ind = pos;
+        }
+    }
+    //不申请任何内存的构造：得到的是被移动过的状态，之后由 ensure_list 申请链表
+    struct hollow {};
+    deque(const Allocator &alloc, hollow) noexcept:storage(alloc), head(nullptr), tail(nullptr), map_size(0),
+    dir(nullptr), fenwick(nullptr), dir_size(0), dir_cap(0), dir_dirty(true), dir_building(false),
+    finger(nullptr), finger_hit(0), finger_miss(0) {}
+public:
     /**
      * TODO Constructors
      */
-    deque():head(new map_node), tail(new map_node), map_size(0) {
-        map_node* new_node = new map_node;
-        new_node->index = 1;
-        new_node->length = 0;
-        new_node->next = tail;
-        new_node->prev = head;
-        head->next = new_node;
-        tail->prev = new_node;
-        chunk_node* new_chunk_node = new chunk_node;
-        new_node->fir_node = new_chunk_node;
-        new_node->las_node = new_chunk_node;
-    }
-    deque(const deque &other):head(new map_node), tail(new map_node), map_size(other.map_size) {
-        map_node* other_ptr = other.head->next;
-        map_node* ptr = head;
-        while (other_ptr != other.tail) {
-            //新建 map_node
-            map_node* new_node = new map_node;
-            new_node->length = other_ptr->length;
-            new_node->index = other_ptr->index;
-            new_node->prev = ptr;
-            ptr->next = new_node;
-            //开始构建 block
-            chunk_node* other_chunk_node = other_ptr->fir_node;
-            if (other_ptr->fir_node == other_ptr->las_node) {
-                chunk_node* new_chunk_node = new chunk_node;
-                new_node->fir_node = new_chunk_node;
-                new_node->las_node = new_chunk_node;
-            } else {
-                //确定 fir_node
-                chunk_node* new_chunk_node = new chunk_node;
-                new_node->fir_node = new_chunk_node;
-                new_chunk_node->data = new T(*other_chunk_node->data);
-                other_chunk_node = other_chunk_node->next;
-                while (other_chunk_node != other_ptr->las_node)
-                {
-                    chunk_node* tmp_chunk_node = new chunk_node;
-                    new_chunk_node->next = tmp_chunk_node;
-                    tmp_chunk_node->prev = new_chunk_node;
-                    tmp_chunk_node->data = new T(*other_chunk_node->data);
-                    new_chunk_node = tmp_chunk_node;
-                    other_chunk_node = other_chunk_node->next;
-                }
-                //set las_node
-                chunk_node* las_node = new chunk_node;
-                new_node->las_node = las_node;
-                las_node->prev = new_chunk_node;
-                new_chunk_node->next = las_node;
-            }
-            other_ptr = other_ptr->next;
-            ptr = new_node;
-        }
-        tail->prev = ptr;
-        ptr->next = tail;
+    deque():deque(Allocator()) {}
+    explicit deque(const Allocator &alloc):deque(alloc, hollow()) {
+        ensure_list();
+    }
+    deque(const deque &other):deque(other, alloc_traits::select_on_container_copy_construction(other.up.alloc)) {}
+    deque(const deque &other, const Allocator &alloc):deque(alloc) {
+        cache_limit = other.cache_limit;
+        assign_list(other);
+    }
+    /**
+     * moves the whole block chain of other in O(1) without allocating; other is left empty
+     * and holds no memory until it is used again.
+     * iterators of other are invalidated.
+     */
+    deque(deque &&other) noexcept:deque(other.up.alloc, hollow()) {
+        swap_data(other);
     }
     /**
      * TODO Deconstructor
      */
     ~deque() {
-        map_node* ptr = head->next;
-        delete head;
-        while (ptr != tail) {
-            chunk_node* tmp_node = ptr->fir_node;
-            while (tmp_node != ptr->las_node) {
-                delete tmp_node->data;
-                tmp_node = tmp_node->next;
-                delete tmp_node->prev;
-            }
-            delete ptr->las_node;
-            ptr = ptr->next;
-            delete ptr->prev;
-        }
-        delete tail;
+        destroy_list();
+        free_dir();
     }
     /**
      * TODO assignment operator
      */
     deque &operator=(const deque &other) {
-        if (this == &other) return *this; 
-        map_node* ptr = head->next;
-        delete head;
-        while (ptr != tail) {
-            chunk_node* tmp_node = ptr->fir_node;
-            while (tmp_node != ptr->las_node) {
-                delete tmp_node->data;
-                tmp_node = tmp_node->next;
-                delete tmp_node->prev;
-            }
-            delete ptr->las_node;
-            ptr = ptr->next;
-            delete ptr->prev;
-        }
-        delete tail;
-        head = new map_node;
-        tail = new map_node;
-        map_size = other.map_size;
-        map_node* other_ptr = other.head->next;
-        ptr = head;
-        while (other_ptr != other.tail) {
-            //新建 map_node
-            map_node* new_node = new map_node;
-            new_node->length = other_ptr->length;
-            new_node->index = other_ptr->index;
-            new_node->prev = ptr;
-            ptr->next = new_node;
-            //开始构建 block
-            chunk_node* other_chunk_node = other_ptr->fir_node;
-            if (other_ptr->fir_node == other_ptr->las_node) {
-                chunk_node* new_chunk_node = new chunk_node;
-                new_node->fir_node = new_chunk_node;
-                new_node->las_node = new_chunk_node;
-            } else {
-                //确定 fir_node
-                chunk_node* new_chunk_node = new chunk_node;
-                new_node->fir_node = new_chunk_node;
-                new_chunk_node->data = new T(*other_chunk_node->data);
-                other_chunk_node = other_chunk_node->next;
-                while (other_chunk_node != other_ptr->las_node)
-                {
-                    chunk_node* tmp_chunk_node = new chunk_node;
-                    new_chunk_node->next = tmp_chunk_node;
-                    tmp_chunk_node->prev = new_chunk_node;
-                    tmp_chunk_node->data = new T(*other_chunk_node->data);
-                    new_chunk_node = tmp_chunk_node;
-                    other_chunk_node = other_chunk_node->next;
-                }
-                //set las_node
-                chunk_node* las_node = new chunk_node;
-                new_node->las_node = las_node;
-                las_node->prev = new_chunk_node;
-                new_chunk_node->next = las_node;
-            }
-            other_ptr = other_ptr->next;
-            ptr = new_node;
+        if (this == &other) return *this;
+        if (alloc_traits::propagate_on_container_copy_assignment::value && !(up.alloc == other.up.alloc)) {
+            //分配器需要跟着复制过来：先用原来的分配器归还所有内存
+            make_hollow();
+            release_storage();
+            assign_alloc(other.up.alloc, typename alloc_traits::propagate_on_container_copy_assignment());
+        }
+        //原有的 block 直接复用
+        assign_list(other);
+        return *this;
+    }
+    /**
+     * takes over the memory of other in O(1) when the allocator propagates or the allocators compare equal
+     * (never throws when that is known at compile time); otherwise the elements are moved one by one.
+     */
+    deque &operator=(deque &&other) noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                                             alloc_traits::is_always_equal::value) {
+        if (this == &other) return *this;
+        if (alloc_traits::propagate_on_container_move_assignment::value || up.alloc == other.up.alloc) {
+            //直接接管 other 的内存，other 变为被移动过的状态，拿走自己原来的结点和 block 缓存
+            make_hollow();
+            swap_data(other);
+            swap_alloc(other, typename alloc_traits::propagate_on_container_move_assignment());
+        } else {
+            //分配器不同又不能传播时，只能逐个移动元素
+            clear();
+            for (iterator it = other.begin(); it != other.end(); ++it) emplace_back(std::move(*it));
+            other.clear();
         }
-        tail->prev = ptr;
-        ptr->next = tail;
         return *this;
     }
+    /**
+     * exchanges the contents with other in O(1).
+     * iterators of both deques are invalidated.
+     * the allocators must compare equal unless they propagate on swap.
+     */
+    void swap(deque &other) noexcept {
+        if (this == &other) return;
+        swap_data(other);
+        swap_alloc(other, typename alloc_traits::propagate_on_container_swap());
+    }
     /**
      * access specified element with bounds checking
      * throw index_out_of_bound if out of bound.
      */
     T & at(const size_t &pos) {
         if (pos >= map_size) throw index_out_of_bound();
-        int ind = pos;
-        iterator tmp(this, head->next->fir_node, 0, head->next);
-            while (tmp.cur_ind + ind >= tmp.node->length) {
-                ind -= tmp.node->length - tmp.cur_ind;
-                tmp.node = tmp.node->next;
-                tmp.cur = tmp.node->fir_node;
-                tmp.cur_ind = 0;
-            }
-            while (ind--) {
-                tmp.cur = tmp.cur->next;
-                tmp.cur_ind++;
-            }
-            return *tmp.cur->data;
+        size_t ind = pos;
+        map_node* node = locate(ind);
+        unshare(node);
+        return *node->get(ind);
     }
     const T & at(const size_t &pos) const {
         if (pos >= map_size) throw index_out_of_bound();
-        int ind = pos;
-        const_iterator tmp(this, head->next->fir_node, 0, head->next);
-            while (tmp.cur_ind + ind >= tmp.node->length) {
-                ind -= tmp.node->length - tmp.cur_ind;
-                tmp.node = tmp.node->next;
-                tmp.cur = tmp.node->fir_node;
-                tmp.cur_ind = 0;
-            }
-            while (ind--) {
-                tmp.cur = tmp.cur->next;
-                tmp.cur_ind++;
-            }
-            return *tmp.cur->data;
+        size_t ind = pos;
+        map_node* node = locate(ind);
+        return *node->get(ind);
     }
     T & operator[](const size_t &pos) {
         if (pos >= map_size) throw index_out_of_bound();
-        int ind = pos;
-        iterator tmp(this, head->next->fir_node, 0, head->next);
-            while (tmp.cur_ind + ind >= tmp.node->length) {
-                ind -= tmp.node->length - tmp.cur_ind;
-                tmp.node = tmp.node->next;
-                tmp.cur = tmp.node->fir_node;
-                tmp.cur_ind = 0;
-            }
-            while (ind--) {
-                tmp.cur = tmp.cur->next;
-                tmp.cur_ind++;
-            }
-            return *tmp.cur->data;
+        size_t ind = pos;
+        map_node* node = locate(ind);
+        unshare(node);
+        return *node->get(ind);
     }
     const T & operator[](const size_t &pos) const {
         if (pos >= map_size) throw index_out_of_bound();
-        int ind = pos;
-        const_iterator tmp(this, head->next->fir_node, 0, head->next);
-            while (tmp.cur_ind + ind >= tmp.node->length) {
-                ind -= tmp.node->length - tmp.cur_ind;
-                tmp.node = tmp.node->next;
-                tmp.cur = tmp.node->fir_node;
-                tmp.cur_ind = 0;
-            }
-            while (ind--) {
-                tmp.cur = tmp.cur->next;
-                tmp.cur_ind++;
-            }
-            return *tmp.cur->data;
+        size_t ind = pos;
+        map_node* node = locate(ind);
+        return *node->get(ind);
     }
     /**
      * access the first element
@@ -796,7 +1582,7 @@ public:
      */
     const T & front() const {
         if (map_size == 0) throw container_is_empty();
-        return *(head->next->fir_node->data);
+        return *head->next->get(0);
     }
     /**
      * access the last element
@@ -804,13 +1590,14 @@ public:
      */
     const T & back() const {
         if (map_size == 0) throw container_is_empty();
-        return *(tail->prev->las_node->prev->data);
+        return *tail->prev->get(tail->prev->length - 1);
     }
     /**
      * returns an iterator to the beginning.
      */
     iterator begin() {
-        iterator tmp(this, head->next->fir_node, 0, head->next);
+        if (head == nullptr) return iterator(this, 0, nullptr);
+        iterator tmp(this, 0, head->next);
         return tmp;
     }
     /**
@@ -819,18 +1606,21 @@ public:
      * in this case a const ptr must be assigned to another ptr otherwise there will be an error
      */
     const_iterator cbegin() const {
-        const_iterator tmp(this, head->next->fir_node, 0, head->next);
+        if (head == nullptr) return const_iterator(this, 0, nullptr);
+        const_iterator tmp(this, 0, head->next);
         return tmp;
     }
     /**
      * returns an iterator to the end.
      */
     iterator end() {
-        iterator tmp(this, tail->prev->las_node, tail->prev->length, tail->prev);
+        if (head == nullptr) return iterator(this, 0, nullptr);
+        iterator tmp(this, tail->prev->length, tail->prev);
         return tmp;
     }
     const_iterator cend() const {
-        const_iterator tmp(this, tail->prev->las_node, tail->prev->length, tail->prev);
+        if (head == nullptr) return const_iterator(this, 0, nullptr);
+        const_iterator tmp(this, tail->prev->length, tail->prev);
         return tmp;
     }
     /**
@@ -841,33 +1631,39 @@ public:
      * returns the number of elements
      */
     size_t size() const { return map_size; }
+    /**
+     * statistics of the finger cache used by at() and operator[]:
+     * a hit is an index resolved in the last accessed block or one of its neighbours,
+     * a miss is an index resolved through the block directory.
+     * only the non-const overloads move the finger and are counted; the const ones just read it.
+     * as with std::deque, any number of threads may call at() and operator[] (const or not) and iterator arithmetic
+     * at the same time as long as none of them modifies the deque: the finger is kept in atomics.
+     * the counters are plain statistics and may miss a few accesses made concurrently.
+     * with cow_pool the non-const overloads count as modifications (see cow_pool).
+     */
+    size_t finger_hits() const { return finger_hit.load(std::memory_order_relaxed); }
+    size_t finger_misses() const { return finger_miss.load(std::memory_order_relaxed); }
+    void reset_finger_stats() {
+        finger_hit.store(0, std::memory_order_relaxed);
+        finger_miss.store(0, std::memory_order_relaxed);
+    }
     /**
      * clears the contents
      */
     void clear() {
-        map_node* ptr = head->next;
-        while (ptr != tail) {
-            chunk_node* tmp_node = ptr->fir_node;
-            while (tmp_node != ptr->las_node) {
-                delete tmp_node->data;
-                tmp_node = tmp_node->next;
-                delete tmp_node->prev;
-            }
-            delete ptr->las_node;
-            ptr = ptr->next;
-            delete ptr->prev;
-        }
-        map_node* new_node = new map_node;
-        new_node->index = 1;
-        new_node->length = 0;
-        new_node->next = tail;
-        new_node->prev = head;
-        head->next = new_node;
-        tail->prev = new_node;
-        chunk_node* new_chunk_node = new chunk_node;
-        new_node->fir_node = new_chunk_node;
-        new_node->las_node = new_chunk_node;
+        if (head == nullptr) return;
+        //只保留第一个 block，其余的析构元素后放进缓存，重新填充时不用再申请
+        map_node* first = head->next;
+        while (first->next != tail) {
+            map_node* block = first->next;
+            first->next = block->next;
+            cache_block(block);
+        }
+        tail->prev = first;
+        reset_block(first);
         map_size = 0;
+        dir_dirty.store(true, std::memory_order_relaxed);
+        finger.store(nullptr, std::memory_order_relaxed);
     }
     /**
      * inserts elements at the specified location on in the container.
@@ -877,163 +1673,201 @@ public:
      */
 private:
     void merge(map_node* cur_block, map_node* next_block) {
-        //链接两个block
-        cur_block->las_node->prev->next = next_block->fir_node;
-        next_block->fir_node->prev = cur_block->las_node->prev;
-        //删掉前面一个的last_node
-        delete cur_block->las_node;
-        //重新设置cur_block的参数
-        cur_block->las_node = next_block->las_node;
-        cur_block->length += next_block->length;
+        unshare(cur_block);
+        unshare(next_block);
+        //把 next_block 的元素接到 cur_block 的末尾
+        for (size_t i = 0; i < next_block->length; ++i) {
+            map_node::relocate(cur_block->get(cur_block->length), next_block->get(i));
+            cur_block->length++;
+        }
+        fenwick_add(cur_block, next_block->length);
+        next_block->length = 0;
+        dir_erase(next_block);
         //链接新的两个map_node
         cur_block->next = next_block->next;
         next_block->next->prev = cur_block;
-        delete next_block;
-        map_node* tmp = cur_block->next;
-        while (tmp != tail) {
-            tmp->index--;
-            tmp = tmp->next;
-        }
-    }
-    //检查有哪些 chunk 需要 merge 或者有 chunk 已经只有0个元素了，需要删掉或者不删（只剩一个 chunk 的情况）
-    void maintainList() {
-        map_node* tmp = head->next;
-        while (tmp->next != tail)
-        {
-            if (tmp->length == 0) {
-                delete tmp->las_node;
-                tmp->prev->next = tmp->next;
-                tmp->next->prev = tmp->prev;
-                map_node* tmp_node = tmp->next;
-                delete tmp;
-                while (tmp_node != tail) {
-                    tmp_node->index--;
-                    tmp_node = tmp_node->next;
-                }
-                return;
+        cache_block(next_block);
+    }
+    //给刚链入链表的 block 分配标号：一般取前后两个标号的中点，O(1)
+    //没有空隙时，以前一个标号为中心把对齐的标号区间 [l, r] 逐次扩大一倍，
+    //直到区间中的 block 个数 cnt 满足 r - l > cnt * cnt，再把区间内的 block 均匀地重新标号，均摊 O(log #blocks)
+    void assign_label(map_node* block) {
+        unsigned long long lo = block->prev->label;
+        if (block->next->label - lo >= 2) {
+            block->label = lo + ((block->next->label - lo) >> 1);
+            return;
+        }
+        map_node* first = block;
+        map_node* last = block;
+        unsigned long long cnt = 1, l = 0, r = ~0ULL;
+        for (int i = 1; i <= 64; ++i) {
+            if (i < 64) {
+                l = lo & ~((1ULL << i) - 1);
+                r = lo | ((1ULL << i) - 1);
+            } else {
+                l = 0;
+                r = ~0ULL;
             }
-            if (tmp->length + tmp->next->length <= (chunk_size >> 1)) {
-                merge(tmp, tmp->next);
-                //合并后可能新的 tail->next == tail，需要特判
-                if (tmp->next == tail) return;
+            while (first->prev != head && first->prev->label >= l) {
+                first = first->prev;
+                cnt++;
             }
-            tmp = tmp->next;
-        }
-        if (tmp->next == tail && tmp->prev != head) {
-            if (tmp->length == 0) {
-                delete tmp->las_node;
-                tmp->prev->next = tmp->next;
-                tmp->next->prev = tmp->prev;
-                map_node* tmp_node = tmp->next;
-                delete tmp;
-                while (tmp_node != tail) {
-                    tmp_node->index--;
-                    tmp_node = tmp_node->next;
-                }
-                return;
+            while (last->next != tail && last->next->label <= r) {
+                last = last->next;
+                cnt++;
             }
+            if (cnt < (1ULL << 32) && r - l > cnt * cnt) break;
         }
-        return;
+        unsigned long long gap = (r - l) / (cnt + 1);
+        unsigned long long k = 1;
+        for (map_node* ptr = first; ptr != last->next; ptr = ptr->next, ++k) ptr->label = l + k * gap;
     }
-    //将 cur 及以后的 chunk_node 装到一个新的 block 里面
-    void spilt(chunk_node* cur, map_node* cur_block) {
+    //删掉空的 block（它不能是唯一的 block）
+    void remove_block(map_node* block) {
+        dir_erase(block);
+        block->prev->next = block->next;
+        block->next->prev = block->prev;
+        cache_block(block);
+    }
+    //block 中删除了元素之后只检查它和前后两个邻居：删掉空的 block（只剩一个 block 时保留），
+    //或者与相邻的 block 合并（两者长度之和不超过前一个 block 容量的一半），O(chunk_size)
+    //(block, ind) 是调用者关心的一个位置，调整后仍然指向同一个元素（或 end()）
+    void maintainBlock(map_node* &block, size_t &ind) {
+        if (block->length == 0) {
+            if (block->prev == head && block->next == tail) return;
+            map_node* tmp = block;
+            if (block->next != tail) {
+                block = block->next;
+                ind = 0;
+            } else {
+                block = block->prev;
+                ind = block->length;
+            }
+            remove_block(tmp);
+            return;
+        }
+        if (block->next != tail && block->length + block->next->length <= (block->capacity() >> 1)) {
+            merge(block, block->next);
+        } else if (block->prev != head && block->prev->length + block->length <= (block->prev->capacity() >> 1)) {
+            ind += block->prev->length;
+            block = block->prev;
+            merge(block, block->next);
+        }
+    }
+    //将 cur_block 中下标 pos 及以后的元素装到一个新的 block 里面
+    void spilt(map_node* cur_block, size_t pos) {
+        unshare(cur_block);
         //new_block is the map_node of the new block
-        map_node* new_block = new map_node;
-        new_block->index = cur_block->index + 1;
+        map_node* new_block = this->new_block(new_capacity(cur_block->length - pos));
         //把新的 map_node 和前后连起来
         new_block->prev = cur_block;
         new_block->next = cur_block->next;
         cur_block->next->prev = new_block;
         cur_block->next = new_block;
-        //暂时只有 cur 这一个 chunk_node 被存到新的 block 里
-        new_block->length = 1;
-        //TODO:这里 cur->prev 还未设置
-        new_block->fir_node = cur;
-        new_block->las_node = cur_block->las_node;
-        //下面开始设置 cur_block (老的 block)
-        //cur_block_las 是 cur_block 新设置的 las_node
-        chunk_node* cur_block_las = new chunk_node;
-        cur_block->las_node = cur_block_las;
-        cur_block_las->prev = cur->prev;
-        cur->prev->next = cur_block_las;
-        //TODO:这里设置 cur->prev(new_block->fir_node->prev)
-        cur->prev = nullptr;
-        //下面开始设置 new_block->length
-        cur = cur->next;
-        while (cur != new_block->las_node) {
+        assign_label(new_block);
+        //搬运元素，新 block 中的元素从 data[0] 开始存放
+        for (size_t i = pos; i < cur_block->length; ++i) {
+            map_node::relocate(new_block->data + new_block->length, cur_block->get(i));
             new_block->length++;
-            cur = cur->next;
-        }
-        cur_block->length -= new_block->length;
-        //更新 map_bode 的 index
-        while (new_block->next != tail)
-        {
-            new_block = new_block->next;
-            new_block->index++;
-        }
-    }
-    //判断是否是 end() 以外的 iterator
-    bool pointer_not_exist(iterator pos) {
-        if (pos.deq == nullptr || pos.cur == nullptr || pos.node == nullptr || pos.cur_ind < 0) return true;
-        map_node* tmp_map_node = head;
-        while (tmp_map_node->next != tail) {
-            tmp_map_node = tmp_map_node->next;
-            if (tmp_map_node->index == pos.node->index) {
-                if (pos.cur_ind < tmp_map_node->length) return false; else return true;
-            }
         }
-        return true;
+        //cur_block 中 pos 及以后的元素搬走了，指向它们的 iterator 失效
+        cur_block->stamp++;
+        //被切到末尾的 block 可以直接追加进目录，其它位置的 spilt 让目录失效
+        if (new_block->next == tail && !dir_dirty.load(std::memory_order_relaxed)) {
+            fenwick_add(cur_block, pos - cur_block->length);
+            cur_block->length = pos;
+            dir_push_back(new_block);
+        } else {
+            cur_block->length = pos;
+            dir_dirty.store(true, std::memory_order_relaxed);
+        }
+    }
+    //判断是否是 end() 以外的 iterator，只需比较版本号，O(1)
+    bool pointer_not_exist(const iterator &pos) const {
+        if (pos.deq != this || pos.node == nullptr || pos.stamp != pos.node->stamp) return true;
+        return pos.cur_ind >= pos.node->length;
     }
     //判断是否是 iterator (including end())
-    bool iterator_not_exist(iterator pos) {
-        if (pos == end()) return false;
-        if (pos.deq == nullptr || pos.cur == nullptr || pos.node == nullptr || pos.cur_ind < 0) return true;
-        map_node* tmp_map_node = head;
-        while (tmp_map_node->next != tail) {
-            tmp_map_node = tmp_map_node->next;
-            if (tmp_map_node->index == pos.node->index) {
-                if (pos.cur_ind < tmp_map_node->length) return false; else return true;
-            }
-        }
-        return true;
+    bool iterator_not_exist(const iterator &pos) const {
+        //被移动过的 deque 只有 (nullptr, 0) 这一个位置
+        if (pos.deq == this && head == nullptr) return pos.node != nullptr || pos.cur_ind != 0;
+        if (pos.deq != this || pos.node == nullptr || pos.stamp != pos.node->stamp) return true;
+        if (pos.node->next == tail) return pos.cur_ind > pos.node->length;
+        return pos.cur_ind >= pos.node->length;
     }
 public:
     iterator insert(iterator pos, const T &value) {
-        if (pos.deq != this || iterator_not_exist(pos)) throw invalid_iterator();
-        chunk_node* new_node = new chunk_node;
-        pos.node->length++;
-        map_size++;
-        //insert at thr first node of the block
-        if (pos.cur_ind == 0) {
-            new_node->next = pos.cur;
-            pos.node->fir_node = new_node;
-            new_node->data = new T(value);
-            pos.cur->prev = new_node;
+        return emplace(pos, value);
+    }
+    iterator insert(iterator pos, T &&value) {
+        return emplace(pos, std::move(value));
+    }
+    /**
+     * inserts count copies of value (or the elements of [first, last)) before pos.
+     * elements are constructed straight into block storage: the block of pos is split at most once
+     * and the new elements fill whole blocks.
+     * returns an iterator pointing to the first inserted element, or pos if nothing is inserted.
+     * throw if the iterator is invalid or it points to a wrong place.
+     */
+    iterator insert(iterator pos, size_t count, const T &value) {
+        //value 可能就是 deque 中的元素，spilt 时会被移走，先复制一份
+        T tmp(value);
+        return insert_range(pos, repeat_iterator<T>{&tmp, count}, repeat_iterator<T>{&tmp, 0});
+    }
+    template<class InputIt, typename std::enable_if<!std::is_integral<InputIt>::value, int>::type = 0>
+    iterator insert(iterator pos, InputIt first, InputIt last) {
+        return insert_range(pos, first, last);
+    }
+    /**
+     * appends the elements of [first, last) to the end, filling whole blocks.
+     */
+    template<class InputIt, typename std::enable_if<!std::is_integral<InputIt>::value, int>::type = 0>
+    void append(InputIt first, InputIt last) {
+        append_range(first, last);
+    }
+    /**
+     * replaces the contents with count copies of value (or the elements of [first, last)).
+     */
+    void assign(size_t count, const T &value) {
+        T tmp(value);
+        clear();
+        append_range(repeat_iterator<T>{&tmp, count}, repeat_iterator<T>{&tmp, 0});
+    }
+    template<class InputIt, typename std::enable_if<!std::is_integral<InputIt>::value, int>::type = 0>
+    void assign(InputIt first, InputIt last) {
+        clear();
+        append_range(first, last);
+    }
+    /**
+     * constructs an element in-place before pos from args.
+     * returns an iterator pointing to the new element.
+     * throw if the iterator is invalid or it points to a wrong place.
+     */
+    template<class... Args>
+    iterator emplace(iterator pos, Args&&... args) {
+        ensure_list(pos);
+        if (check_iterator && iterator_not_exist(pos)) throw invalid_iterator();
+        if (pos.cur_ind == 0 || pos.cur_ind == pos.node->length) {
+            construct_in(pos.node, pos.cur_ind, std::forward<Args>(args)...);
         } else {
-            //ordinary insert
-            new_node->next = pos.cur;
-            new_node->prev = pos.cur->prev;
-            new_node->data = new T(value);
-            new_node->prev->next = new_node;
-            new_node->next->prev = new_node;
-        }
-        if (pos.node->length >= chunk_size) {
-            chunk_node* tmp_node = pos.node->fir_node;
-            int tmp = 0;
-            while (tmp < (chunk_size >> 1)) {
-                tmp_node = tmp_node->next;
-                tmp++;
-            }
-            spilt(tmp_node, pos.node);
-            if (pos.cur_ind < (chunk_size >> 1)) {
-                iterator ans(this, new_node, pos.cur_ind, pos.node);
+            //在 block 中间插入要先移动已有元素，参数可能正引用着其中某个元素，所以先构造出来再移进去
+            T tmp(std::forward<Args>(args)...);
+            construct_in(pos.node, pos.cur_ind, std::move(tmp));
+        }
+        update_length(pos.node, 1);
+        map_size++;
+        size_t half = pos.node->capacity() >> 1;
+        if (pos.node->length >= pos.node->capacity()) {
+            spilt(pos.node, half);
+            if (pos.cur_ind < half) {
+                iterator ans(this, pos.cur_ind, pos.node);
                 return ans;
             } else {
-                iterator ans(this, new_node, pos.cur_ind - (chunk_size >> 1), pos.node->next);
+                iterator ans(this, pos.cur_ind - half, pos.node->next);
                 return ans;
             }
         } else {
-            iterator ans(this, new_node, pos.cur_ind, pos.node);
+            iterator ans(this, pos.cur_ind, pos.node);
             return ans;
         }
     }
@@ -1045,74 +1879,206 @@ public:
      */
     iterator erase(iterator pos) {
         if (map_size == 0) throw container_is_empty();
-        if (pos.deq != this || pointer_not_exist(pos)) throw invalid_iterator();
-        //record the position of the chunk_node of the next iterator (maybe the end())
-        iterator tmp = pos + 1;
-        int flag = 0;
-        if (tmp == end()) flag = 1;
-        map_node* min_node = pos.node->prev;
+        if (check_iterator && pointer_not_exist(pos)) throw invalid_iterator();
+        //删除后 (node, ind) 就是下一个元素的位置
+        map_node* node = pos.node;
+        size_t ind = pos.cur_ind;
+        unshare(node);
         map_size--;
-        if (pos.cur_ind == 0) {
-            pos.node->fir_node = pos.cur->next;
-            pos.cur->next->prev = nullptr;
-            pos.node->length--;
+        alloc_traits::destroy(up.alloc, node->get(ind));
+        node->remove(ind);
+        update_length(node, size_t(-1));
+        maintainBlock(node, ind);
+        if (ind == node->length && node->next != tail) {
+            node = node->next;
+            ind = 0;
+        }
+        return iterator(this, ind, node);
+    }
+    /**
+     * removes the elements in [first, last).
+     * whole blocks strictly between first and last are unlinked at once, the two boundary blocks are trimmed,
+     * and only they are rebalanced afterwards.
+     * returns an iterator pointing to the element that followed the last removed one (last itself if nothing is removed).
+     * throw if an iterator is invalid or first is after last.
+     */
+    iterator erase(iterator first, iterator last) {
+        if (check_iterator && iterator_not_exist(last)) throw invalid_iterator();
+        if (first == last) return last;
+        if (check_iterator && pointer_not_exist(first)) throw invalid_iterator();
+        map_node* block = first.node;
+        map_node* last_block = last.node;
+        if (block == last_block ? first.cur_ind > last.cur_ind : block->label > last_block->label) throw invalid_iterator();
+        size_t ind = first.cur_ind;
+        //只有两端被截断的 block 需要独占，中间整个删掉的 block 只放弃共享
+        unshare(block);
+        if (last.cur_ind > 0) unshare(last_block);
+        if (block == last_block) {
+            size_t cnt = last.cur_ind - ind;
+            destroy_elements(block, ind, last.cur_ind);
+            block->remove_range(ind, cnt);
+            update_length(block, 0 - cnt);
+            map_size -= cnt;
         } else {
-            pos.cur->prev->next = pos.cur->next;
-            pos.cur->next->prev = pos.cur->prev;
-            pos.node->length--;
-        }
-        delete pos.cur->data;
-        delete pos.cur;
-        maintainList();
-        //寻找返回的 iterator 在哪个 map_node 上，是 chunk 中第几个（iterator 含这些元素）
-        if (flag) return end();
-        size_t ind = 0;
-        chunk_node* tmp_chunk_node = tmp.cur;
-        while (tmp_chunk_node->prev != nullptr) {
-            ind++;
-            tmp_chunk_node = tmp_chunk_node->prev;
-        }
-        tmp.cur_ind = ind;
-        map_node* tmp_map_node = head->next;
-        while (tmp_map_node != tail) {
-            if (tmp_map_node->fir_node == tmp_chunk_node) {
-                tmp.node = tmp_map_node;
-                return tmp;
+            //first 所在 block 截掉 ind 以后的部分，last 所在 block 截掉 last 之前的部分
+            size_t cnt = block->length - ind;
+            destroy_elements(block, ind);
+            block->remove_range(ind, cnt);
+            update_length(block, 0 - cnt);
+            map_size -= cnt;
+            cnt = last.cur_ind;
+            destroy_elements(last_block, 0, cnt);
+            last_block->remove_range(0, cnt);
+            update_length(last_block, 0 - cnt);
+            map_size -= cnt;
+            //中间的 block 整个删掉
+            while (block->next != last_block) {
+                map_node* tmp = block->next;
+                map_size -= tmp->length;
+                dir_erase(tmp);
+                block->next = tmp->next;
+                tmp->next->prev = block;
+                cache_block(tmp);
+            }
+            finger.store(nullptr, std::memory_order_relaxed);
+            //合并之前先删掉空了的 first 所在 block，(block, ind) 改为指向 last 的元素
+            if (block->length == 0) {
+                remove_block(block);
+            }
+            block = last_block;
+            ind = 0;
+        }
+        maintainBlock(block, ind);
+        if (ind == block->length && block->next != tail) {
+            block = block->next;
+            ind = 0;
+        }
+        return iterator(this, ind, block);
+    }
+    /**
+     * removes every element for which pred returns true, keeping the order of the others.
+     * each block is compacted in place in one pass, emptied blocks are released,
+     * and neighbouring blocks are merged once at the end, O(n).
+     * returns the number of removed elements.
+     */
+    template<class Pred>
+    size_t remove_if(Pred pred) {
+        if (head == nullptr) return 0;
+        //block 的长度会改变，也可能被删除，目录等下一次随机访问时重建
+        dir_dirty.store(true, std::memory_order_relaxed);
+        finger.store(nullptr, std::memory_order_relaxed);
+        size_t removed = 0;
+        map_node* block = head->next;
+        while (block != tail) {
+            map_node* next = block->next;
+            removed += compact_block(block, pred);
+            block = next;
+        }
+        //只在最后合并一次：相邻两个 block 的长度之和不超过前一个容量的一半时合并
+        for (block = head->next; block != tail; block = block->next) {
+            while (block->next != tail && block->length + block->next->length <= (block->capacity() >> 1)) {
+                merge(block, block->next);
             }
-            tmp_map_node = tmp_map_node->next;
         }
+        return removed;
+    }
+    /**
+     * moves all elements of other to the end (or to the beginning) of this deque, leaving other empty.
+     * with a transferable Pool (heap_pool, cow_pool) and equal allocators the storage of every block of other
+     * is handed over as it is, so no element is copied or moved, and at most one pair of blocks is merged.
+     * the cost depends only on other: O(#blocks of other), each handed-over block taking a label between its neighbours
+     * (amortized O(log #blocks)) and, at the back, a slot in the block directory; the blocks of this deque are not touched.
+     * other keeps its own block nodes for reuse, so repeated splices do not pile up memory in either deque;
+     * that is why the blocks are handed over one by one rather than relinked as a whole.
+     * otherwise (slab_pool, or different allocators) the elements are moved one by one.
+     * iterators of other are invalidated.
+     */
+    void splice_back(deque &&other) {
+        splice_list(other, false);
+    }
+    void splice_front(deque &&other) {
+        splice_list(other, true);
+    }
+    /**
+     * removes [pos, end()) from this deque and returns it as a new deque with the same allocator.
+     * with a transferable Pool (heap_pool, cow_pool) the block of pos is split once and the storage of the blocks
+     * after it is handed over as it is, O(chunk_size + #blocks moved), and the block directory of this deque is just cut short;
+     * with slab_pool the block storage belongs to this deque's slabs, so the elements are moved instead, O(end() - pos).
+     * throw if the iterator is invalid or it points to a wrong place.
+     */
+    deque split_at(iterator pos) {
+        ensure_list(pos);
+        if (check_iterator && iterator_not_exist(pos)) throw invalid_iterator();
+        deque result(up.alloc);
+        result.cache_limit = cache_limit;
+        if (pos == end()) return result;
+        if (!Pool::transferable) {
+            for (iterator it = pos; it != end(); ++it) result.emplace_back(std::move(*it));
+            erase(pos, end());
+            return result;
+        }
+        map_node* block = pos.node;
+        //先准备好 result 接住 block 用的 map_node，以及整个 deque 都被拿走时自己剩下的空 block
+        size_t count = 0;
+        for (map_node* ptr = block; ptr != tail; ptr = ptr->next) count++;
+        map_node* nodes = result.take_nodes(count);
+        map_node* empty = nullptr;
+        if (pos.cur_ind == 0 && block->prev == head) empty = new_block(adaptive ? min_chunk_size : chunk_size);
+        if (pos.cur_ind > 0) {
+            spilt(block, pos.cur_ind);
+            block = block->next;
+        }
+        map_node* prefix_last = block->prev;
+        map_node* first = result.head->next;
+        result.head->next = result.tail;
+        result.tail->prev = result.head;
+        result.cache_block(first);
+        result.move_blocks(*this, block, tail, result.head, nodes);
+        if (empty != nullptr) {
+            init_list(empty);
+            dir_push_back(empty);
+        } else {
+            size_t ind = prefix_last->length;
+            maintainBlock(prefix_last, ind);
+        }
+        first = result.head->next;
+        size_t ind = 0;
+        result.maintainBlock(first, ind);
+        return result;
     }
     /**
      * adds an element to the end
      */
     void push_back(const T &value) {
-        iterator pos = end(); 
-        chunk_node* new_node = new chunk_node;
-        pos.node->length++;
-        map_size++;
-        //insert at thr first node of the block
-        if (pos.cur_ind == 0) {
-            new_node->next = pos.cur;
-            pos.node->fir_node = new_node;
-            new_node->data = new T(value);
-            pos.cur->prev = new_node;
+        emplace_back(value);
+    }
+    void push_back(T &&value) {
+        emplace_back(std::move(value));
+    }
+    /**
+     * constructs an element in-place at the end and returns a reference to it.
+     */
+    template<class... Args>
+    T &emplace_back(Args&&... args) {
+        ensure_list();
+        map_node* node = tail->prev;
+        if (node->length + 1 < node->capacity()) {
+            construct_in(node, node->length, std::forward<Args>(args)...);
         } else {
-            //ordinary insert
-            new_node->next = pos.cur;
-            new_node->prev = pos.cur->prev;
-            new_node->data = new T(value);
-            new_node->prev->next = new_node;
-            new_node->next->prev = new_node;
-        }
-        if (pos.node->length >= chunk_size) {
-            chunk_node* tmp_node = pos.node->fir_node;
-            int tmp = 0;
-            while (tmp < (chunk_size >> 1)) {
-                tmp_node = tmp_node->next;
-                tmp++;
+            //最后一个 block 只剩一个空位（与 append_range 相同，block 总是留一个空位）时，
+            //新元素放进新链入的 block，已有的元素不用移动，只做 push_back 的 deque 的 block 都是满的
+            node = link_block(node);
+            dir_push_back(node);
+            try {
+                construct_in(node, 0, std::forward<Args>(args)...);
+            } catch (...) {
+                remove_block(node);
+                throw;
             }
-            spilt(tmp_node, pos.node);
         }
+        update_length(node, 1);
+        map_size++;
+        return *node->get(node->length - 1);
     }
     /**
      * removes the last element
@@ -1120,53 +2086,51 @@ public:
      */
     void pop_back() {
         if (map_size == 0) throw container_is_empty();
-        iterator pos = end() - 1;
+        map_node* node = tail->prev;
+        unshare(node);
         map_size--;
+        alloc_traits::destroy(up.alloc, node->get(node->length - 1));
+        node->remove(node->length - 1);
+        update_length(node, size_t(-1));
         //考虑pop 后 chunk 空了后可能需要删除的情况
-        if (pos.cur_ind == 0) {
-            if (pos.node->prev == head) {
-                pos.node->fir_node = pos.cur->next;
-                pos.cur->next->prev = nullptr;
-                pos.node->length--;
-            } else {
-                delete pos.node->las_node;
-                pos.node->prev->next = tail;
-                tail->prev = pos.node->prev;
-                delete pos.node;
-            }
-        } else {
-            pos.cur->prev->next = pos.cur->next;
-            pos.cur->next->prev = pos.cur->prev;
-            pos.node->length--;
-            if (pos.node->prev != head && pos.node->prev->length + pos.node->length <= (chunk_size >> 1)) {
-                merge(pos.node->prev, pos.node);
-            }
+        if (node->length == 0) {
+            if (node->prev != head) remove_block(node);
+        } else if (node->prev != head && node->prev->length + node->length <= (node->prev->capacity() >> 1)) {
+            merge(node->prev, node);
         }
-        delete pos.cur->data;
-        delete pos.cur;
     }
     /**
      * inserts an element to the beginning.
      */
     void push_front(const T &value) {
-        iterator pos = begin(); 
-        chunk_node* new_node = new chunk_node;
-        pos.node->length++;
-        map_size++;
-        new_node->next = pos.cur;
-        pos.node->fir_node = new_node;
-        new_node->data = new T(value);
-        pos.cur->prev = new_node;
-        //判断当前 chunk 是否已经达到 chunk_size 上限
-        if (pos.node->length >= chunk_size) {
-            chunk_node* tmp_node = pos.node->fir_node;
-            int tmp = 0;
-            while (tmp < (chunk_size >> 1)) {
-                tmp_node = tmp_node->next;
-                tmp++;
+        emplace_front(value);
+    }
+    void push_front(T &&value) {
+        emplace_front(std::move(value));
+    }
+    /**
+     * constructs an element in-place at the beginning and returns a reference to it.
+     */
+    template<class... Args>
+    T &emplace_front(Args&&... args) {
+        ensure_list();
+        map_node* node = head->next;
+        if (node->length + 1 < node->capacity()) {
+            construct_in(node, 0, std::forward<Args>(args)...);
+        } else {
+            //第一个 block 只剩一个空位时在最前面链入新的 block，与 emplace_back 对称
+            node = link_block(head);
+            dir_dirty.store(true, std::memory_order_relaxed);
+            try {
+                construct_in(node, 0, std::forward<Args>(args)...);
+            } catch (...) {
+                remove_block(node);
+                throw;
             }
-            spilt(tmp_node, pos.node);
         }
+        update_length(node, 1);
+        map_size++;
+        return *node->get(0);
     }
     /**
      * removes the first element.
@@ -1174,32 +2138,73 @@ public:
      */
     void pop_front() {
         if (map_size == 0) throw container_is_empty();
-        iterator pos = begin();
+        map_node* node = head->next;
+        unshare(node);
         map_size--;
-        pos.node->fir_node = pos.cur->next;
-        pos.cur->next->prev = nullptr;
-        pos.node->length--;
-        delete pos.cur->data;
-        delete pos.cur;
+        alloc_traits::destroy(up.alloc, node->get(0));
+        node->remove(0);
+        update_length(node, size_t(-1));
         //判断是否需要删除为0的 chunk
-        if (pos.node->length == 0 && pos.node->next != tail) {
-            delete pos.node->las_node;
-            head->next = pos.node->next;
-            pos.node->next->prev = head;
-            delete pos.node;
-            map_node* tmp_node = head->next;
-            while (tmp_node != tail) {
-                tmp_node->index--;
-                tmp_node = tmp_node->next;
-            }
+        if (node->length == 0 && node->next != tail) {
+            remove_block(node);
             //只有chunk数量超过2个才可以合并
-        } else if (pos.node->length != 0 && pos.node->next != tail) {
-            if (pos.node->length + pos.node->next->length <= (chunk_size >> 1))
-            merge(pos.node, pos.node->next);
+        } else if (node->length != 0 && node->next != tail) {
+            if (node->length + node->next->length <= (node->capacity() >> 1))
+            merge(node, node->next);
         }
     }
 };
 
+template<class T, class Allocator, class Pool, size_t ChunkSize, bool CheckIterators>
+void swap(deque<T, Allocator, Pool, ChunkSize, CheckIterators> &lhs, deque<T, Allocator, Pool, ChunkSize, CheckIterators> &rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+/**
+ * removes every element of d satisfying pred in a single compaction pass, returns the number removed.
+ */
+template<class T, class Allocator, class Pool, size_t ChunkSize, bool CheckIterators, class Pred>
+size_t erase_if(deque<T, Allocator, Pool, ChunkSize, CheckIterators> &d, Pred pred) {
+    return d.remove_if(pred);
 }
 
+/**
+ * rope_deque 定义在 rope_deque.hpp 中（本文件末尾引入），这里给出模板参数的默认值
+ */
+template<class T, class Allocator = std::allocator<T>, class Pool = heap_pool, size_t ChunkSize = default_chunk_size<T>::value,
+         bool CheckIterators = true>
+class rope_deque;
+
+/**
+ * 选择 deque 的实现方式的策略，作为 basic_deque 的第二个模板参数：
+ * list_engine 是 block 链表加目录（sjtu::deque），两端操作 O(1)，随机插入删除 O(sqrt n)；
+ * tree_engine 是 block treap（sjtu::rope_deque），随机访问、插入、删除都是 O(log n)。
+ * 两者接口相同，可以在每个使用的地方单独选择。
+ */
+struct list_engine {
+    template<class T, class Allocator, class Pool, size_t ChunkSize, bool CheckIterators>
+    using container = deque<T, Allocator, Pool, ChunkSize, CheckIterators>;
+};
+struct tree_engine {
+    template<class T, class Allocator, class Pool, size_t ChunkSize, bool CheckIterators>
+    using container = rope_deque<T, Allocator, Pool, ChunkSize, CheckIterators>;
+};
+template<class T, class Engine = list_engine, class Allocator = std::allocator<T>, class Pool = heap_pool,
+         size_t ChunkSize = default_chunk_size<T>::value, bool CheckIterators = true>
+using basic_deque = typename Engine::template container<T, Allocator, Pool, ChunkSize, CheckIterators>;
+
+#ifdef SJTU_DEQUE_HAS_PMR
+namespace pmr {
+/**
+ * 使用 std::pmr::memory_resource 作为内存来源的 deque
+ */
+template<class T, class Pool = heap_pool, size_t ChunkSize = default_chunk_size<T>::value, bool CheckIterators = true>
+using deque = sjtu::deque<T, std::pmr::polymorphic_allocator<T>, Pool, ChunkSize, CheckIterators>;
+}
+#endif
+
+}
+
+#include "rope_deque.hpp"
+
 #endif
@@ -38,6 +38,10 @@ class invalid_iterator : public exception {
 class container_is_empty : public exception {
     /* __________________________ */
 };
+
+class container_is_full : public exception {
+    /* __________________________ */
+};
 }
 
 #endif
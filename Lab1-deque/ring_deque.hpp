@@ -0,0 +1,392 @@
+#ifndef SJTU_RING_DEQUE_HPP
+#define SJTU_RING_DEQUE_HPP
+
+#include "exceptions.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sjtu {
+/**
+ * ring_deque 满了以后再 push 的处理方式，作为 ring_deque 的第二个模板参数：
+ * reject 抛出 container_is_full（try_push_back、try_push_front 返回 false），容器不变；
+ * overwrite 丢掉另一端最老的元素（push_back 丢掉 front，push_front 丢掉 back）。
+ */
+enum class ring_full { reject, overwrite };
+/**
+ * ring_deque：容量在构造时固定的 deque，用于固定深度的缓冲区。
+ * 元素放在一段连续的、长度为 2 的幂的环形存储空间中，两端的 push、pop 和随机访问都只需要一次按位与，O(1)，
+ * 不会再申请内存，也没有 block 的 spilt 和 merge。
+ * 元素用一个不断递增（push_front 时递减）的绝对编号标识，编号 i 的元素存放在 data[i & mask]，
+ * iterator 记录的就是这个编号，所以另一端的 push 和 pop 不会让它失效，检查是否合法也只需要 O(1)。
+ * 被移动过的 ring_deque 没有存储空间（data 为 nullptr），容量为 0，push 总是抛出 container_is_full，
+ * 直到把另一个 ring_deque 赋值给它。
+ */
+template<class T, ring_full Full = ring_full::reject, class Allocator = std::allocator<T>>
+class ring_deque {
+private:
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    Allocator alloc;
+    //data 的长度是 mask + 1（2 的幂），first 是第一个元素的编号，元素个数为 count
+    //没有存储空间时 data 为 nullptr，mask 为 size_t(-1)，容量 mask + 1 正好是 0
+    T* data;
+    size_t mask;
+    size_t first;
+    size_t count;
+    //不小于 n 的最小的 2 的幂（至少为 1）
+    static size_t round_up(size_t n) {
+        size_t cap = 1;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+    T* slot(size_t ind) const { return data + (ind & mask); }
+public:
+    class const_iterator;
+    class iterator {
+    private:
+        ring_deque *deq;
+        //元素的绝对编号
+        size_t ind;
+    public:
+        iterator():deq(nullptr), ind(0) {}
+        iterator(ring_deque *host_deq, size_t index):deq(host_deq), ind(index) {}
+        iterator(const iterator &other) = default;
+        iterator &operator=(const iterator &other) = default;
+        iterator operator+(const int &n) const { return iterator(deq, ind + n); }
+        iterator operator-(const int &n) const { return iterator(deq, ind - n); }
+        /**
+         * return the signed distance between two iterator.
+         * throw invalid_iterator if they belong to different containers.
+         */
+        int operator-(const iterator &rhs) const {
+            if (deq != rhs.deq) throw invalid_iterator();
+            return int((long long)(ind - rhs.ind));
+        }
+        iterator& operator+=(const int &n) {
+            ind += n;
+            return *this;
+        }
+        iterator& operator-=(const int &n) {
+            ind -= n;
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++ind;
+            return tmp;
+        }
+        iterator& operator++() {
+            ++ind;
+            return *this;
+        }
+        iterator operator--(int) {
+            iterator tmp = *this;
+            --ind;
+            return tmp;
+        }
+        iterator& operator--() {
+            --ind;
+            return *this;
+        }
+        /**
+         * throw invalid_iterator if the element has been popped or overwritten.
+         */
+        T& operator*() const {
+            if (deq == nullptr || ind - deq->first >= deq->count) throw invalid_iterator();
+            return *deq->slot(ind);
+        }
+        T* operator->() const noexcept { return deq->slot(ind); }
+        bool operator==(const iterator &rhs) const { return deq == rhs.deq && ind == rhs.ind; }
+        bool operator==(const const_iterator &rhs) const { return deq == rhs.deq && ind == rhs.ind; }
+        bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+        bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+    friend class ring_deque;
+    friend class const_iterator;
+    };
+    class const_iterator {
+    private:
+        const ring_deque *deq;
+        size_t ind;
+    public:
+        const_iterator():deq(nullptr), ind(0) {}
+        const_iterator(const ring_deque *host_deq, size_t index):deq(host_deq), ind(index) {}
+        const_iterator(const const_iterator &other) = default;
+        const_iterator(const iterator &other):deq(other.deq), ind(other.ind) {}
+        const_iterator &operator=(const const_iterator &other) = default;
+        const_iterator operator+(const int &n) const { return const_iterator(deq, ind + n); }
+        const_iterator operator-(const int &n) const { return const_iterator(deq, ind - n); }
+        int operator-(const const_iterator &rhs) const {
+            if (deq != rhs.deq) throw invalid_iterator();
+            return int((long long)(ind - rhs.ind));
+        }
+        const_iterator& operator+=(const int &n) {
+            ind += n;
+            return *this;
+        }
+        const_iterator& operator-=(const int &n) {
+            ind -= n;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator tmp = *this;
+            ++ind;
+            return tmp;
+        }
+        const_iterator& operator++() {
+            ++ind;
+            return *this;
+        }
+        const_iterator operator--(int) {
+            const_iterator tmp = *this;
+            --ind;
+            return tmp;
+        }
+        const_iterator& operator--() {
+            --ind;
+            return *this;
+        }
+        const T& operator*() const {
+            if (deq == nullptr || ind - deq->first >= deq->count) throw invalid_iterator();
+            return *deq->slot(ind);
+        }
+        const T* operator->() const noexcept { return deq->slot(ind); }
+        bool operator==(const iterator &rhs) const { return deq == rhs.deq && ind == rhs.ind; }
+        bool operator==(const const_iterator &rhs) const { return deq == rhs.deq && ind == rhs.ind; }
+        bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+        bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+    friend class ring_deque;
+    friend class iterator;
+    };
+private:
+    //还能不能再放一个元素：没满，或者满了但可以丢掉另一端的元素；容量为 0 时没有元素可丢
+    bool has_room() const {
+        return !full() || (Full == ring_full::overwrite && data != nullptr);
+    }
+    void allocate_storage(size_t capacity) {
+        size_t cap = round_up(capacity);
+        data = alloc_traits::allocate(alloc, cap);
+        mask = cap - 1;
+    }
+    //申请和 other 一样大的存储空间，other 没有存储空间时自己也不申请
+    void allocate_like(const ring_deque &other) {
+        if (other.data == nullptr) return;
+        allocate_storage(other.capacity());
+    }
+    //释放存储空间，变为容量为 0 的状态
+    void free_storage() {
+        if (data != nullptr) alloc_traits::deallocate(alloc, data, mask + 1);
+        data = nullptr;
+        mask = size_t(-1);
+    }
+    //逐个复制 other 的元素，构造抛出异常时已经复制的元素仍然在容器中
+    void copy_from(const ring_deque &other) {
+        for (size_t i = 0; i < other.count; ++i) {
+            alloc_traits::construct(alloc, slot(first + count), *other.slot(other.first + i));
+            count++;
+        }
+    }
+    void assign_alloc(const Allocator &a, std::true_type) { alloc = a; }
+    void assign_alloc(const Allocator &, std::false_type) {}
+    void swap_alloc(ring_deque &other, std::true_type) { std::swap(alloc, other.alloc); }
+    void swap_alloc(ring_deque &, std::false_type) {}
+public:
+    /**
+     * constructs an empty container holding at most capacity elements;
+     * the storage is rounded up to a power of two and capacity() reports the rounded value.
+     */
+    explicit ring_deque(size_t capacity, const Allocator &a = Allocator()):alloc(a), data(nullptr), mask(0), first(0), count(0) {
+        allocate_storage(capacity);
+    }
+    ring_deque(const ring_deque &other):alloc(alloc_traits::select_on_container_copy_construction(other.alloc)),
+    data(nullptr), mask(size_t(-1)), first(0), count(0) {
+        allocate_like(other);
+        try {
+            copy_from(other);
+        } catch (...) {
+            clear();
+            free_storage();
+            throw;
+        }
+    }
+    /**
+     * takes the storage of other in O(1) without allocating; other is left without storage and with a capacity of 0.
+     */
+    ring_deque(ring_deque &&other) noexcept:alloc(other.alloc), data(other.data), mask(other.mask), first(other.first),
+    count(other.count) {
+        other.data = nullptr;
+        other.mask = size_t(-1);
+        other.first = 0;
+        other.count = 0;
+    }
+    ~ring_deque() {
+        clear();
+        free_storage();
+    }
+    /**
+     * the capacity is copied along with the elements.
+     */
+    ring_deque &operator=(const ring_deque &other) {
+        if (this == &other) return *this;
+        clear();
+        bool new_alloc = alloc_traits::propagate_on_container_copy_assignment::value && !(alloc == other.alloc);
+        if (new_alloc || mask != other.mask) {
+            free_storage();
+            assign_alloc(other.alloc, typename alloc_traits::propagate_on_container_copy_assignment());
+            allocate_like(other);
+        }
+        first = 0;
+        copy_from(other);
+        return *this;
+    }
+    /**
+     * O(1) and never throws when the allocator propagates or always compares equal;
+     * otherwise the elements are copied into storage of this container's allocator.
+     */
+    ring_deque &operator=(ring_deque &&other) noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                                                       alloc_traits::is_always_equal::value) {
+        if (this == &other) return *this;
+        if (alloc_traits::propagate_on_container_move_assignment::value || alloc == other.alloc) {
+            clear();
+            std::swap(data, other.data);
+            std::swap(mask, other.mask);
+            std::swap(first, other.first);
+            std::swap(count, other.count);
+            swap_alloc(other, typename alloc_traits::propagate_on_container_move_assignment());
+        } else {
+            *this = static_cast<const ring_deque &>(other);
+            other.clear();
+        }
+        return *this;
+    }
+    /**
+     * exchanges the contents (and capacities) with other in O(1).
+     */
+    void swap(ring_deque &other) noexcept {
+        std::swap(data, other.data);
+        std::swap(mask, other.mask);
+        std::swap(first, other.first);
+        std::swap(count, other.count);
+        swap_alloc(other, typename alloc_traits::propagate_on_container_swap());
+    }
+    Allocator get_allocator() const { return alloc; }
+    /**
+     * access specified element with bounds checking, O(1).
+     * throw index_out_of_bound if out of bound.
+     */
+    T & at(const size_t &pos) {
+        if (pos >= count) throw index_out_of_bound();
+        return *slot(first + pos);
+    }
+    const T & at(const size_t &pos) const {
+        if (pos >= count) throw index_out_of_bound();
+        return *slot(first + pos);
+    }
+    T & operator[](const size_t &pos) { return at(pos); }
+    const T & operator[](const size_t &pos) const { return at(pos); }
+    /**
+     * throw container_is_empty when the container is empty.
+     */
+    const T & front() const {
+        if (count == 0) throw container_is_empty();
+        return *slot(first);
+    }
+    const T & back() const {
+        if (count == 0) throw container_is_empty();
+        return *slot(first + count - 1);
+    }
+    iterator begin() { return iterator(this, first); }
+    const_iterator cbegin() const { return const_iterator(this, first); }
+    iterator end() { return iterator(this, first + count); }
+    const_iterator cend() const { return const_iterator(this, first + count); }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == capacity(); }
+    size_t size() const { return count; }
+    size_t capacity() const { return mask + 1; }
+    void clear() {
+        while (count != 0) pop_back();
+    }
+    /**
+     * constructs an element in-place at the end (at the beginning) and returns a reference to it.
+     * when the container is full, throw container_is_full (ring_full::reject)
+     * or drop the element at the other end first (ring_full::overwrite).
+     * a container without storage (moved from) always throws container_is_full.
+     */
+    template<class... Args>
+    T &emplace_back(Args&&... args) {
+        if (!has_room()) throw container_is_full();
+        if (full()) {
+            //参数可能正引用着要被丢掉的元素，先构造出来
+            T tmp(std::forward<Args>(args)...);
+            pop_front();
+            return emplace_back(std::move(tmp));
+        }
+        alloc_traits::construct(alloc, slot(first + count), std::forward<Args>(args)...);
+        count++;
+        return *slot(first + count - 1);
+    }
+    template<class... Args>
+    T &emplace_front(Args&&... args) {
+        if (!has_room()) throw container_is_full();
+        if (full()) {
+            T tmp(std::forward<Args>(args)...);
+            pop_back();
+            return emplace_front(std::move(tmp));
+        }
+        alloc_traits::construct(alloc, slot(first - 1), std::forward<Args>(args)...);
+        first--;
+        count++;
+        return *slot(first);
+    }
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+    void push_front(const T &value) { emplace_front(value); }
+    void push_front(T &&value) { emplace_front(std::move(value)); }
+    /**
+     * like push_back (push_front), but returns false instead of throwing when a ring_full::reject container is full.
+     */
+    bool try_push_back(const T &value) {
+        if (!has_room()) return false;
+        emplace_back(value);
+        return true;
+    }
+    bool try_push_back(T &&value) {
+        if (!has_room()) return false;
+        emplace_back(std::move(value));
+        return true;
+    }
+    bool try_push_front(const T &value) {
+        if (!has_room()) return false;
+        emplace_front(value);
+        return true;
+    }
+    bool try_push_front(T &&value) {
+        if (!has_room()) return false;
+        emplace_front(std::move(value));
+        return true;
+    }
+    /**
+     * throw container_is_empty when the container is empty.
+     */
+    void pop_back() {
+        if (count == 0) throw container_is_empty();
+        alloc_traits::destroy(alloc, slot(first + count - 1));
+        count--;
+    }
+    void pop_front() {
+        if (count == 0) throw container_is_empty();
+        alloc_traits::destroy(alloc, slot(first));
+        first++;
+        count--;
+    }
+};
+
+template<class T, ring_full Full, class Allocator>
+void swap(ring_deque<T, Full, Allocator> &lhs, ring_deque<T, Full, Allocator> &rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+}
+
+#endif
@@ -0,0 +1,1079 @@
+#ifndef SJTU_ROPE_DEQUE_HPP
+#define SJTU_ROPE_DEQUE_HPP
+
+#include "deque.hpp"
+
+namespace sjtu {
+/**
+ * rope_deque 的结点：block_node 加上 treap 的指针
+ */
+template<class T, size_t ChunkSize>
+class rope_node : public block_node<T, ChunkSize> {
+public:
+    //treap 中的左右儿子和父亲
+    rope_node* left;
+    rope_node* right;
+    rope_node* parent;
+    //空闲链表、缓存链表中的下一个结点，也用来临时按中序串起所有 block
+    rope_node* next;
+    //子树中的元素个数（包括自己）
+    size_t sum;
+    //treap 的优先级：父亲的优先级不小于儿子
+    unsigned priority;
+    rope_node():left(nullptr), right(nullptr), parent(nullptr), next(nullptr), sum(0), priority(0) {}
+    //放回 spare_node 或缓存之前从树中断开
+    void clear_links() { left = right = parent = nullptr; }
+    //中序的后一个、前一个 block，没有时返回 nullptr；遍历所有 block 均摊 O(1)
+    rope_node* successor() const {
+        const rope_node* x = this;
+        if (x->right != nullptr) {
+            x = x->right;
+            while (x->left != nullptr) x = x->left;
+            return const_cast<rope_node*>(x);
+        }
+        while (x->parent != nullptr && x->parent->right == x) x = x->parent;
+        return x->parent;
+    }
+    rope_node* predecessor() const {
+        const rope_node* x = this;
+        if (x->left != nullptr) {
+            x = x->left;
+            while (x->right != nullptr) x = x->right;
+            return const_cast<rope_node*>(x);
+        }
+        while (x->parent != nullptr && x->parent->left == x) x = x->parent;
+        return x->parent;
+    }
+};
+/**
+ * rope_deque：与 deque 接口相同的另一种实现，block 不再串成链表，而是放在一棵以子树元素个数为权值的 treap 里。
+ * 中序遍历 treap 得到所有 block 的顺序，每个结点的 sum 是子树中的元素个数，
+ * 所以 at、[]、insert、erase 和 iterator 的跳转都只需要从根走到一个结点，期望 O(log n)。
+ * 适合元素非常多（block 数上百万）、又经常在中间插入删除的场合；两端的 push 和 pop 也要更新到根的路径，O(log n)。
+ * ChunkSize、Allocator、Pool 和 CheckIterators 的含义与 deque 相同，只有一处例外：cow_pool 在这里不共享 block，
+ * 复制 rope_deque 总是逐个复制元素，cow_pool 只相当于 heap_pool（splice_back、split_at 仍然直接交出存储空间）。
+ * 结点、block 缓存和 pool 都由与 deque 共用的 block_storage 管理，模板参数的默认值见 deque.hpp 中的声明。
+ */
+template<class T, class Allocator, class Pool, size_t ChunkSize, bool CheckIterators>
+class rope_deque : private block_storage<T, Allocator, Pool, rope_node<T, ChunkSize>> {
+public:
+    typedef rope_node<T, ChunkSize> tree_node;
+    typedef block_iterator<rope_deque, tree_node, false> iterator;
+    typedef block_iterator<rope_deque, tree_node, true> const_iterator;
+    //与 deque 相同，CheckIterators 为 false 时不再检查传入的 iterator
+    static const bool check_iterator = CheckIterators;
+    //ChunkSize 为 adaptive_chunk_size 时每个 block 有自己的容量，chunk_size 是容量的上限
+    static const bool adaptive = ChunkSize == adaptive_chunk_size;
+    static const size_t chunk_size = adaptive ? max_adaptive_chunk_size : ChunkSize;
+    static_assert(adaptive || ChunkSize >= 4, "a block must hold at least 4 elements");
+private:
+    //treap 的根和中序的第一个、最后一个 block，树中至少有一个 block，只有它可以为空
+    tree_node* root;
+    tree_node* leftmost;
+    tree_node* rightmost;
+    //结点的优先级由 xorshift 生成
+    unsigned long long seed;
+    typedef block_storage<T, Allocator, Pool, tree_node> storage;
+    typedef typename storage::alloc_traits alloc_traits;
+    typedef typename storage::shares_blocks shares_blocks;
+    using storage::cache_limit;
+    using storage::up;
+    using storage::destroy_elements;
+    using storage::drop_node;
+    using storage::delete_block;
+    using storage::cache_block;
+    using storage::unshare;
+    using storage::copy_block;
+    using storage::take_nodes;
+    using storage::give_nodes;
+    using storage::hand_over;
+    using storage::release_storage;
+    using storage::swap_storage;
+    using storage::assign_alloc;
+    using storage::swap_alloc;
+    template<class, class, bool> friend class block_iterator;
+public:
+    using storage::get_allocator;
+    using storage::block_cache_limit;
+    using storage::set_block_cache_limit;
+private:
+    static size_t sum_of(const tree_node* x) { return x == nullptr ? 0 : x->sum; }
+    static void recalc(tree_node* x) { x->sum = x->length + sum_of(x->left) + sum_of(x->right); }
+    //x 及其所有祖先的 sum 加上 delta（可以是 size_t(-k)），O(depth)
+    static void add_up(tree_node* x, size_t delta) {
+        for (; x != nullptr; x = x->parent) x->sum += delta;
+    }
+    unsigned next_priority() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return unsigned(seed >> 32);
+    }
+    //新 block 的容量，与 deque::new_capacity 相同：自适应时取不小于 sqrt(size()) 且能放下 need 个元素的最小的 2 的幂
+    size_t new_capacity(size_t need) const {
+        if (!adaptive) return chunk_size;
+        size_t cap = min_chunk_size;
+        while (cap < chunk_size && (cap * cap < sum_of(root) || cap <= need)) cap <<= 1;
+        return cap;
+    }
+    //申请一个不在树中、至少能放下 need 个元素的空 block，优先使用缓存中的 block
+    tree_node* new_block(size_t need = 0) {
+        tree_node* block = storage::new_block(new_capacity(need));
+        block->sum = 0;
+        block->priority = next_priority();
+        return block;
+    }
+    //重新建一棵只有一个空 block 的树
+    void init_tree() {
+        init_tree(new_block());
+    }
+    void init_tree(tree_node* block) {
+        root = leftmost = rightmost = block;
+    }
+    //把 x 转到它父亲的位置，两者的 sum 随之调整，O(1)
+    void rotate_up(tree_node* x) {
+        tree_node* p = x->parent;
+        tree_node* g = p->parent;
+        if (p->left == x) {
+            p->left = x->right;
+            if (x->right != nullptr) x->right->parent = p;
+            x->right = p;
+        } else {
+            p->right = x->left;
+            if (x->left != nullptr) x->left->parent = p;
+            x->left = p;
+        }
+        p->parent = x;
+        x->parent = g;
+        if (g == nullptr) root = x;
+        else if (g->left == p) g->left = x;
+        else g->right = x;
+        x->sum = p->sum;
+        recalc(p);
+    }
+    void sift_up(tree_node* x) {
+        while (x->parent != nullptr && x->parent->priority < x->priority) rotate_up(x);
+    }
+    //把不在树中的 block 按中序接到 pos 之后（之前），期望 O(log #blocks)
+    void link_after(tree_node* pos, tree_node* block) {
+        block->left = block->right = nullptr;
+        block->sum = block->length;
+        if (pos->right == nullptr) {
+            pos->right = block;
+            block->parent = pos;
+        } else {
+            tree_node* x = pos->right;
+            while (x->left != nullptr) x = x->left;
+            x->left = block;
+            block->parent = x;
+        }
+        add_up(block->parent, block->length);
+        if (pos == rightmost) rightmost = block;
+        sift_up(block);
+    }
+    void link_before(tree_node* pos, tree_node* block) {
+        block->left = block->right = nullptr;
+        block->sum = block->length;
+        if (pos->left == nullptr) {
+            pos->left = block;
+            block->parent = pos;
+        } else {
+            tree_node* x = pos->left;
+            while (x->right != nullptr) x = x->right;
+            x->right = block;
+            block->parent = x;
+        }
+        add_up(block->parent, block->length);
+        if (pos == leftmost) leftmost = block;
+        sift_up(block);
+    }
+    //把 block 从树中摘下来（先转到最多只有一个儿子的位置），祖先的 sum 减去它的长度，期望 O(log #blocks)
+    void unlink(tree_node* block) {
+        if (block == leftmost) leftmost = block->successor();
+        if (block == rightmost) rightmost = block->predecessor();
+        while (block->left != nullptr && block->right != nullptr) {
+            rotate_up(block->left->priority > block->right->priority ? block->left : block->right);
+        }
+        tree_node* child = block->left != nullptr ? block->left : block->right;
+        tree_node* p = block->parent;
+        if (child != nullptr) child->parent = p;
+        if (p == nullptr) root = child;
+        else if (p->left == block) p->left = child;
+        else p->right = child;
+        add_up(p, 0 - block->length);
+        block->left = block->right = block->parent = nullptr;
+    }
+    //删掉 block（它不能是唯一的 block）
+    void remove_block(tree_node* block) {
+        unlink(block);
+        cache_block(block);
+    }
+    //treap 的合并：a 中所有 block 都在 b 之前，返回新的根，期望 O(log #blocks)
+    static tree_node* join(tree_node* a, tree_node* b) {
+        if (a == nullptr) return b;
+        if (b == nullptr) return a;
+        if (a->priority > b->priority) {
+            a->right = join(a->right, b);
+            a->right->parent = a;
+            recalc(a);
+            return a;
+        }
+        b->left = join(a, b->left);
+        b->left->parent = b;
+        recalc(b);
+        return b;
+    }
+    //treap 的分裂：x 为根的子树中前 k 个元素所在的 block 放进 a，其余的放进 b，k 必须落在 block 的边界上
+    //两棵树的根的 parent 由调用者清空，期望 O(log #blocks)
+    static void split(tree_node* x, size_t k, tree_node* &a, tree_node* &b) {
+        if (x == nullptr) {
+            a = b = nullptr;
+            return;
+        }
+        size_t l = sum_of(x->left);
+        if (k <= l) {
+            split(x->left, k, a, x->left);
+            if (x->left != nullptr) x->left->parent = x;
+            b = x;
+        } else {
+            split(x->right, k - l - x->length, x->right, b);
+            if (x->right != nullptr) x->right->parent = x;
+            a = x;
+        }
+        recalc(x);
+    }
+    //按中序逐个追加 block，线性地建一棵 treap：last 是上一个追加的 block，树的右链就是栈
+    //右链上结点的 sum 只包含自己和左子树，弹出右链时才加上右子树，全部追加完以后由 spine_root 补上并返回根
+    static void spine_append(tree_node* &last, tree_node* block) {
+        tree_node* child = nullptr;
+        tree_node* cur = last;
+        while (cur != nullptr && cur->priority < block->priority) {
+            recalc(cur);
+            child = cur;
+            cur = cur->parent;
+        }
+        block->left = child;
+        block->right = nullptr;
+        if (child != nullptr) child->parent = block;
+        block->parent = cur;
+        if (cur != nullptr) cur->right = block;
+        block->sum = block->length + sum_of(child);
+        last = block;
+    }
+    static tree_node* spine_root(tree_node* last) {
+        tree_node* x = last;
+        recalc(x);
+        while (x->parent != nullptr) {
+            x = x->parent;
+            recalc(x);
+        }
+        return x;
+    }
+    //用 spine_append 建好的树作为整棵树，一个 block 也没有时重新建一棵空树
+    void finish_spine(tree_node* last) {
+        if (last == nullptr) {
+            init_tree();
+            return;
+        }
+        root = spine_root(last);
+        for (leftmost = root; leftmost->left != nullptr; leftmost = leftmost->left);
+        rightmost = last;
+    }
+    //从 first 开始把它所在的树中 first 及以后的 block 按中序用 next 串起来返回（不保持树的任何不变量，调用者负责重建）
+    static tree_node* collect(tree_node* first) {
+        tree_node* list = nullptr;
+        tree_node** tail = &list;
+        for (tree_node* x = first; x != nullptr; x = x->successor()) {
+            *tail = x;
+            tail = &x->next;
+        }
+        *tail = nullptr;
+        for (tree_node* x = list; x != nullptr; x = x->next) x->clear_links();
+        return list;
+    }
+    //把树中所有 block 按中序串起来返回，树变为空
+    tree_node* collect_all() {
+        tree_node* list = collect(leftmost);
+        root = leftmost = rightmost = nullptr;
+        return list;
+    }
+    //在 block 的第 ind 个位置原地构造新元素，构造抛出异常时把空出来的位置收回
+    template<class... Args>
+    void construct_in(tree_node* block, size_t ind, Args&&... args) {
+        unshare(block);
+        T* slot = block->make_room(ind);
+        try {
+            alloc_traits::construct(up.alloc, slot, std::forward<Args>(args)...);
+        } catch (...) {
+            block->remove(ind);
+            throw;
+        }
+        add_up(block, 1);
+    }
+    //把 next_block 的元素接到 block 的末尾，删掉 next_block
+    void merge(tree_node* block, tree_node* next_block) {
+        size_t k = next_block->length;
+        for (size_t i = 0; i < k; ++i) tree_node::relocate(block->get(block->length + i), next_block->get(i));
+        next_block->length = 0;
+        add_up(next_block, 0 - k);
+        remove_block(next_block);
+        block->length += k;
+        add_up(block, k);
+    }
+    //将 block 中下标 pos 及以后的元素装到一个新的 block 里面，接在 block 后面
+    void spilt(tree_node* block, size_t pos) {
+        tree_node* new_block = this->new_block(block->length - pos);
+        for (size_t i = pos; i < block->length; ++i) {
+            tree_node::relocate(new_block->data + new_block->length, block->get(i));
+            new_block->length++;
+        }
+        block->stamp++;
+        add_up(block, pos - block->length);
+        block->length = pos;
+        link_after(block, new_block);
+    }
+    //block 中删除了元素之后只检查它和前后两个邻居，与 deque::maintainBlock 相同
+    void maintainBlock(tree_node* &block, size_t &ind) {
+        if (block->length == 0) {
+            if (block == root && block->left == nullptr && block->right == nullptr) return;
+            tree_node* tmp = block;
+            if (block != rightmost) {
+                block = block->successor();
+                ind = 0;
+            } else {
+                block = block->predecessor();
+                ind = block->length;
+            }
+            remove_block(tmp);
+            return;
+        }
+        tree_node* next = block == rightmost ? nullptr : block->successor();
+        if (next != nullptr && block->length + next->length <= (block->capacity() >> 1)) {
+            merge(block, next);
+            return;
+        }
+        tree_node* prev = block == leftmost ? nullptr : block->predecessor();
+        if (prev != nullptr && prev->length + block->length <= (prev->capacity() >> 1)) {
+            ind += prev->length;
+            merge(prev, block);
+            block = prev;
+        }
+    }
+    //第 pos 个元素所在的 block，pos 变为它在 block 中的下标（pos < size()），O(depth)
+    tree_node* locate(size_t &pos) const {
+        tree_node* x = root;
+        while (true) {
+            size_t l = sum_of(x->left);
+            if (pos < l) {
+                x = x->left;
+            } else if (pos - l < x->length) {
+                pos -= l;
+                return x;
+            } else {
+                pos -= l + x->length;
+                x = x->right;
+            }
+        }
+    }
+    //(block, ind) 的全局下标：加上沿途所有左侧子树的元素个数，O(depth)
+    //已经被删除的 block 不在树中，说明 iterator 已经失效
+    size_t index_of(tree_node* block, size_t ind) const {
+        if (root == nullptr) return ind;
+        if (block == nullptr || (block->parent == nullptr && block != root)) throw invalid_iterator();
+        size_t pos = ind + sum_of(block->left);
+        for (tree_node* x = block; x->parent != nullptr; x = x->parent) {
+            if (x->parent->right == x) pos += sum_of(x->parent->left) + x->parent->length;
+        }
+        return pos;
+    }
+    //把 (block, ind) 向后移动 n 个元素（n 可以为负），越过 begin() 或 end() 时下标越界但不会出错
+    void jump(tree_node* &block, size_t &ind, long long n) const {
+        if (root == nullptr) {
+            ind += n;
+            return;
+        }
+        if (n >= 0 ? ind + size_t(n) < block->length : size_t(-n) <= ind) {
+            ind += n;
+            return;
+        }
+        long long target = (long long)index_of(block, ind) + n;
+        if (target < 0) {
+            block = leftmost;
+            ind = size_t(target);
+        } else if (size_t(target) >= root->sum) {
+            block = rightmost;
+            ind = size_t(target) - (root->sum - block->length);
+        } else {
+            size_t pos = size_t(target);
+            block = locate(pos);
+            ind = pos;
+        }
+    }
+    //在 block 末尾的空位上逐个构造 [first, last) 中的元素，直到 block 只剩一个空位或者元素用完
+    //构造抛出异常时 block 仍然是完整的，sum 与已经构造的元素一致
+    template<class InputIt>
+    void fill_block(tree_node* block, InputIt &first, InputIt last) {
+        size_t old_length = block->length;
+        try {
+            for (; first != last && block->length + 1 < block->capacity(); ++first) {
+                alloc_traits::construct(up.alloc, block->get(block->length), *first);
+                block->length++;
+            }
+        } catch (...) {
+            add_up(block, block->length - old_length);
+            throw;
+        }
+        add_up(block, block->length - old_length);
+    }
+    //在 after 后面（after 为 nullptr 时在最前面）接上若干个新 block 来放 [first, last)
+    //新 block 先接进树再填充，填充时抛出异常则删掉还空着的那一个
+    template<class InputIt>
+    void link_range(tree_node* after, InputIt &first, InputIt last) {
+        while (first != last) {
+            tree_node* block = new_block();
+            if (after == nullptr) link_before(leftmost, block);
+            else link_after(after, block);
+            try {
+                fill_block(block, first, last);
+            } catch (...) {
+                if (block->length == 0) remove_block(block);
+                throw;
+            }
+            after = block;
+        }
+    }
+    template<class InputIt>
+    void append_range(InputIt first, InputIt last) {
+        ensure_tree();
+        fill_block(rightmost, first, last);
+        link_range(rightmost, first, last);
+    }
+    //在 pos 前插入 [first, last)：把 pos 所在的 block 从 pos 处 spilt 一次，新元素接在前半部分的末尾，
+    //放不下时在中间接上新的 block，每个新 block 期望 O(log #blocks)
+    template<class InputIt>
+    iterator insert_range(iterator pos, InputIt first, InputIt last) {
+        ensure_tree(pos);
+        if (check_iterator && iterator_not_exist(pos)) throw invalid_iterator();
+        if (first == last) return pos;
+        tree_node* block = pos.node;
+        size_t ind = pos.cur_ind;
+        size_t index = index_of(block, ind);
+        if (block == rightmost && ind == block->length) {
+            append_range(first, last);
+        } else {
+            //rest 是 pos 及以后的元素所在的 block，新元素都放在它前面
+            tree_node* rest = block;
+            if (ind > 0) {
+                spilt(block, ind);
+                rest = block->successor();
+                fill_block(block, first, last);
+                link_range(block, first, last);
+            } else {
+                link_range(block == leftmost ? nullptr : block->predecessor(), first, last);
+            }
+            size_t rest_ind = 0;
+            maintainBlock(rest, rest_ind);
+        }
+        block = locate(index);
+        return iterator(this, index, block);
+    }
+    //把 block 中不满足 pred 的元素按原来的顺序紧缩到前面，满足的析构掉，返回删除的个数
+    //sum 不在这里维护，调用者之后重建整棵树
+    template<class Pred>
+    size_t compact_block(tree_node* block, Pred &pred) {
+        size_t w = 0, i = 0;
+        try {
+            for (; i < block->length; ++i) {
+                T* ptr = block->get(i);
+                if (pred(*ptr)) {
+                    alloc_traits::destroy(up.alloc, ptr);
+                } else {
+                    if (w != i) tree_node::relocate(block->get(w), ptr);
+                    w++;
+                }
+            }
+        } catch (...) {
+            for (; i < block->length; ++i, ++w) {
+                if (w != i) tree_node::relocate(block->get(w), block->get(i));
+            }
+            if (w != block->length) block->stamp++;
+            block->length = w;
+            throw;
+        }
+        if (w != block->length) block->stamp++;
+        size_t removed = block->length - w;
+        block->length = w;
+        return removed;
+    }
+    //用 next 串起来的 block 按顺序重建 treap：删掉空的 block，相邻两个长度之和不超过容量一半时合并
+    void rebuild(tree_node* list) {
+        tree_node* last = nullptr;
+        while (list != nullptr) {
+            tree_node* block = list;
+            list = list->next;
+            block->next = nullptr;
+            if (block->length == 0) {
+                cache_block(block);
+            } else if (last != nullptr && last->length + block->length <= (last->capacity() >> 1)) {
+                for (size_t i = 0; i < block->length; ++i) {
+                    tree_node::relocate(last->get(last->length + i), block->get(i));
+                }
+                last->length += block->length;
+                last->sum += block->length;
+                block->length = 0;
+                cache_block(block);
+            } else {
+                spine_append(last, block);
+            }
+        }
+        finish_spine(last);
+    }
+    //把 other 的内容按 block 复制过来：原有的 block 析构元素后按顺序复用，不够时再申请，多出来的放进缓存
+    //复制抛出异常时已经复制好的部分仍然是一棵完整的树
+    void assign_tree(const rope_deque &other) {
+        tree_node* reuse = collect_all();
+        for (tree_node* x = reuse; x != nullptr; x = x->next) {
+            destroy_elements(x);
+            x->start = 0;
+            x->length = 0;
+            x->stamp++;
+        }
+        tree_node* last = nullptr;
+        try {
+            for (const tree_node* src = other.leftmost; src != nullptr; src = src->successor()) {
+                if (src->length == 0) continue;
+                //自适应时复用的 block 可能放不下 src（还要留出一个空位），放进缓存，另外申请
+                while (reuse != nullptr && reuse->capacity() <= src->length) {
+                    tree_node* block = reuse;
+                    reuse = reuse->next;
+                    cache_block(block);
+                }
+                tree_node* block;
+                if (reuse != nullptr) {
+                    block = reuse;
+                    reuse = reuse->next;
+                    block->next = nullptr;
+                } else {
+                    block = new_block(src->length);
+                }
+                spine_append(last, block);
+                copy_block(block, src, block->sum, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+            }
+        } catch (...) {
+            finish_spine(last);
+            while (reuse != nullptr) {
+                tree_node* block = reuse;
+                reuse = reuse->next;
+                cache_block(block);
+            }
+            throw;
+        }
+        finish_spine(last);
+        while (reuse != nullptr) {
+            tree_node* block = reuse;
+            reuse = reuse->next;
+            cache_block(block);
+        }
+    }
+    //释放树中所有的 block，root 变为 nullptr，即被移动过的状态
+    void destroy_tree() {
+        tree_node* list = collect_all();
+        while (list != nullptr) {
+            tree_node* block = list;
+            list = list->next;
+            delete_block(block);
+        }
+    }
+    //被移动过的 rope_deque 不占用任何内存（root 为 nullptr），直到下一次需要时才建树
+    void ensure_tree() {
+        if (root == nullptr) init_tree();
+    }
+    //pos 是被移动过的 rope_deque 自己的 begin() 或 end() 时，建树以后换成新的 end()
+    void ensure_tree(iterator &pos) {
+        if (root != nullptr) return;
+        init_tree();
+        if (pos.deq == this && pos.node == nullptr) pos = end();
+    }
+    //交换除分配器以外的全部内容，O(1)
+    void swap_data(rope_deque &other) {
+        std::swap(root, other.root);
+        std::swap(leftmost, other.leftmost);
+        std::swap(rightmost, other.rightmost);
+        std::swap(seed, other.seed);
+        swap_storage(other);
+    }
+    //把 list（用 next 串起来的另一个 rope_deque other 的 block）的存储空间依次交给 nodes 中自己的结点，
+    //按中序建成一棵树并返回它的根，last 为其中最后一个 block；原来的结点留在 other 中（见 hand_over），O(#blocks)
+    tree_node* take_blocks(rope_deque &other, tree_node* list, tree_node* nodes, tree_node* &last) {
+        last = nullptr;
+        while (list != nullptr) {
+            tree_node* block = list;
+            list = list->next;
+            tree_node* node = nodes;
+            nodes = nodes->next;
+            hand_over(other, block, node);
+            node->priority = next_priority();
+            spine_append(last, node);
+        }
+        return spine_root(last);
+    }
+    //把 other 的整棵树合并到末尾（front 为 true 时合并到开头），接头处最多合并一次，other 变为空
+    //other 的 block 交给自己的结点 O(#blocks of other)，两棵树的合并期望 O(log #blocks)
+    void splice_tree(rope_deque &other, bool front) {
+        if (this == &other || other.size() == 0) return;
+        ensure_tree();
+        if (!Pool::transferable || !(up.alloc == other.up.alloc)) {
+            //只能逐个移动元素
+            if (front) {
+                iterator it = other.end();
+                while (it != other.begin()) {
+                    --it;
+                    emplace_front(std::move(*it));
+                }
+            } else {
+                for (iterator it = other.begin(); it != other.end(); ++it) emplace_back(std::move(*it));
+            }
+            other.clear();
+            return;
+        }
+        //先准备好所有要用的内存：自己接住 other 的 block 用的结点，other 之后剩下的那个空 block
+        size_t count = 0;
+        for (tree_node* x = other.leftmost; x != nullptr; x = x->successor()) count++;
+        tree_node* nodes = take_nodes(count);
+        tree_node* empty;
+        try {
+            empty = other.new_block();
+        } catch (...) {
+            give_nodes(nodes);
+            throw;
+        }
+        tree_node* last;
+        tree_node* sub = take_blocks(other, other.collect_all(), nodes, last);
+        other.init_tree(empty);
+        tree_node* first = sub;
+        while (first->left != nullptr) first = first->left;
+        tree_node* left = front ? last : rightmost;
+        if (size() == 0) {
+            cache_block(root);
+            root = sub;
+            leftmost = first;
+            rightmost = last;
+            left = nullptr;
+        } else if (front) {
+            root = join(sub, root);
+            leftmost = first;
+        } else {
+            root = join(root, sub);
+            rightmost = last;
+        }
+        root->parent = nullptr;
+        if (left != nullptr) {
+            tree_node* right = left->successor();
+            if (left->length + right->length <= (left->capacity() >> 1)) merge(left, right);
+        }
+    }
+    //iterator 在 block 之间移动时用到
+    bool is_first_block(tree_node* block) const { return block == leftmost; }
+    bool is_last_block(tree_node* block) const { return block == rightmost; }
+    static tree_node* next_block(tree_node* block) { return block->successor(); }
+    static tree_node* prev_block(tree_node* block) { return block->predecessor(); }
+    //判断是否是 end() 以外的 iterator，只需比较版本号，O(1)
+    bool pointer_not_exist(const iterator &pos) const {
+        if (pos.deq != this || pos.node == nullptr || pos.stamp != pos.node->stamp) return true;
+        return pos.cur_ind >= pos.node->length;
+    }
+    //判断是否是 iterator (including end())
+    bool iterator_not_exist(const iterator &pos) const {
+        //被移动过的 rope_deque 只有 (nullptr, 0) 这一个位置
+        if (pos.deq == this && root == nullptr) return pos.node != nullptr || pos.cur_ind != 0;
+        if (pos.deq != this || pos.node == nullptr || pos.stamp != pos.node->stamp) return true;
+        if (pos.node == rightmost) return pos.cur_ind > pos.node->length;
+        return pos.cur_ind >= pos.node->length;
+    }
+    //不申请任何内存的构造：得到的是被移动过的状态，之后由 ensure_tree 建树
+    struct hollow {};
+    rope_deque(const Allocator &alloc, hollow) noexcept:storage(alloc), root(nullptr), leftmost(nullptr), rightmost(nullptr),
+    seed(0x9E3779B97F4A7C15ULL) {}
+public:
+    rope_deque():rope_deque(Allocator()) {}
+    explicit rope_deque(const Allocator &alloc):rope_deque(alloc, hollow()) {
+        init_tree();
+    }
+    rope_deque(const rope_deque &other):rope_deque(other, alloc_traits::select_on_container_copy_construction(other.up.alloc)) {}
+    rope_deque(const rope_deque &other, const Allocator &alloc):rope_deque(alloc) {
+        cache_limit = other.cache_limit;
+        assign_tree(other);
+    }
+    /**
+     * moves the whole tree of other in O(1) without allocating; other is left empty
+     * and holds no memory until it is used again.
+     */
+    rope_deque(rope_deque &&other) noexcept:rope_deque(other.up.alloc, hollow()) {
+        swap_data(other);
+    }
+    ~rope_deque() {
+        destroy_tree();
+    }
+    rope_deque &operator=(const rope_deque &other) {
+        if (this == &other) return *this;
+        if (alloc_traits::propagate_on_container_copy_assignment::value && !(up.alloc == other.up.alloc)) {
+            destroy_tree();
+            release_storage();
+            assign_alloc(other.up.alloc, typename alloc_traits::propagate_on_container_copy_assignment());
+        }
+        assign_tree(other);
+        return *this;
+    }
+    /**
+     * same as deque: O(1) and never throws when the allocator propagates or always compares equal.
+     */
+    rope_deque &operator=(rope_deque &&other) noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                                                       alloc_traits::is_always_equal::value) {
+        if (this == &other) return *this;
+        if (alloc_traits::propagate_on_container_move_assignment::value || up.alloc == other.up.alloc) {
+            destroy_tree();
+            swap_data(other);
+            swap_alloc(other, typename alloc_traits::propagate_on_container_move_assignment());
+        } else {
+            clear();
+            for (iterator it = other.begin(); it != other.end(); ++it) emplace_back(std::move(*it));
+            other.clear();
+        }
+        return *this;
+    }
+    void swap(rope_deque &other) noexcept {
+        if (this == &other) return;
+        swap_data(other);
+        swap_alloc(other, typename alloc_traits::propagate_on_container_swap());
+    }
+    /**
+     * access specified element with bounds checking, O(log n).
+     * throw index_out_of_bound if out of bound.
+     */
+    T & at(const size_t &pos) {
+        if (pos >= size()) throw index_out_of_bound();
+        size_t ind = pos;
+        tree_node* node = locate(ind);
+        return *node->get(ind);
+    }
+    const T & at(const size_t &pos) const {
+        if (pos >= size()) throw index_out_of_bound();
+        size_t ind = pos;
+        tree_node* node = locate(ind);
+        return *node->get(ind);
+    }
+    T & operator[](const size_t &pos) {
+        return at(pos);
+    }
+    const T & operator[](const size_t &pos) const {
+        return at(pos);
+    }
+    /**
+     * throw container_is_empty when the container is empty.
+     */
+    const T & front() const {
+        if (size() == 0) throw container_is_empty();
+        return *leftmost->get(0);
+    }
+    const T & back() const {
+        if (size() == 0) throw container_is_empty();
+        return *rightmost->get(rightmost->length - 1);
+    }
+    iterator begin() { return iterator(this, 0, leftmost); }
+    const_iterator cbegin() const { return const_iterator(this, 0, leftmost); }
+    iterator end() { return iterator(this, rightmost == nullptr ? 0 : rightmost->length, rightmost); }
+    const_iterator cend() const { return const_iterator(this, rightmost == nullptr ? 0 : rightmost->length, rightmost); }
+    bool empty() const { return sum_of(root) == 0; }
+    size_t size() const { return sum_of(root); }
+    /**
+     * rope_deque has no finger cache: at() and operator[] always walk down from the root in O(log n).
+     * these are kept so that code written against deque compiles unchanged; the counters are always 0.
+     */
+    size_t finger_hits() const { return 0; }
+    size_t finger_misses() const { return 0; }
+    void reset_finger_stats() {}
+    /**
+     * clears the contents, all iterators are invalidated.
+     */
+    void clear() {
+        if (root == nullptr) return;
+        tree_node* list = collect_all();
+        while (list != nullptr) {
+            tree_node* block = list;
+            list = list->next;
+            cache_block(block);
+        }
+        init_tree();
+    }
+    /**
+     * inserts value before pos and returns an iterator pointing to the inserted value, O(chunk_size + log n).
+     * throw if the iterator is invalid or it points to a wrong place.
+     */
+    iterator insert(iterator pos, const T &value) {
+        return emplace(pos, value);
+    }
+    iterator insert(iterator pos, T &&value) {
+        return emplace(pos, std::move(value));
+    }
+    /**
+     * inserts count copies of value (or the elements of [first, last)) before pos, filling whole blocks.
+     * returns an iterator pointing to the first inserted element, or pos if nothing is inserted.
+     */
+    iterator insert(iterator pos, size_t count, const T &value) {
+        T tmp(value);
+        return insert_range(pos, repeat_iterator<T>{&tmp, count}, repeat_iterator<T>{&tmp, 0});
+    }
+    template<class InputIt, typename std::enable_if<!std::is_integral<InputIt>::value, int>::type = 0>
+    iterator insert(iterator pos, InputIt first, InputIt last) {
+        return insert_range(pos, first, last);
+    }
+    template<class InputIt, typename std::enable_if<!std::is_integral<InputIt>::value, int>::type = 0>
+    void append(InputIt first, InputIt last) {
+        append_range(first, last);
+    }
+    void assign(size_t count, const T &value) {
+        T tmp(value);
+        clear();
+        append_range(repeat_iterator<T>{&tmp, count}, repeat_iterator<T>{&tmp, 0});
+    }
+    template<class InputIt, typename std::enable_if<!std::is_integral<InputIt>::value, int>::type = 0>
+    void assign(InputIt first, InputIt last) {
+        clear();
+        append_range(first, last);
+    }
+    template<class... Args>
+    iterator emplace(iterator pos, Args&&... args) {
+        ensure_tree(pos);
+        if (check_iterator && iterator_not_exist(pos)) throw invalid_iterator();
+        if (pos.cur_ind == 0 || pos.cur_ind == pos.node->length) {
+            construct_in(pos.node, pos.cur_ind, std::forward<Args>(args)...);
+        } else {
+            T tmp(std::forward<Args>(args)...);
+            construct_in(pos.node, pos.cur_ind, std::move(tmp));
+        }
+        size_t half = pos.node->capacity() >> 1;
+        if (pos.node->length >= pos.node->capacity()) {
+            spilt(pos.node, half);
+            if (pos.cur_ind >= half) return iterator(this, pos.cur_ind - half, pos.node->successor());
+        }
+        return iterator(this, pos.cur_ind, pos.node);
+    }
+    /**
+     * removes the element at pos, O(chunk_size + log n).
+     * returns an iterator pointing to the following element, or end() if pos was the last element.
+     * throw if the container is empty, the iterator is invalid or it points to a wrong place.
+     */
+    iterator erase(iterator pos) {
+        if (size() == 0) throw container_is_empty();
+        if (check_iterator && pointer_not_exist(pos)) throw invalid_iterator();
+        tree_node* node = pos.node;
+        size_t ind = pos.cur_ind;
+        alloc_traits::destroy(up.alloc, node->get(ind));
+        node->remove(ind);
+        add_up(node, size_t(-1));
+        maintainBlock(node, ind);
+        if (ind == node->length && node != rightmost) {
+            node = node->successor();
+            ind = 0;
+        }
+        return iterator(this, ind, node);
+    }
+    /**
+     * removes the elements in [first, last); whole blocks in between are removed at once.
+     * returns an iterator pointing to the element that followed the last removed one.
+     * throw if an iterator is invalid or first is after last.
+     */
+    iterator erase(iterator first, iterator last) {
+        if (check_iterator && iterator_not_exist(last)) throw invalid_iterator();
+        if (first == last) return last;
+        if (check_iterator && pointer_not_exist(first)) throw invalid_iterator();
+        tree_node* block = first.node;
+        tree_node* last_block = last.node;
+        if (index_of(block, first.cur_ind) > index_of(last_block, last.cur_ind)) throw invalid_iterator();
+        size_t ind = first.cur_ind;
+        if (block == last_block) {
+            size_t cnt = last.cur_ind - ind;
+            destroy_elements(block, ind, last.cur_ind);
+            block->remove_range(ind, cnt);
+            add_up(block, 0 - cnt);
+        } else {
+            size_t cnt = block->length - ind;
+            destroy_elements(block, ind);
+            block->remove_range(ind, cnt);
+            add_up(block, 0 - cnt);
+            cnt = last.cur_ind;
+            destroy_elements(last_block, 0, cnt);
+            last_block->remove_range(0, cnt);
+            add_up(last_block, 0 - cnt);
+            for (tree_node* tmp = block->successor(); tmp != last_block; tmp = block->successor()) remove_block(tmp);
+            if (block->length == 0) remove_block(block);
+            block = last_block;
+            ind = 0;
+        }
+        maintainBlock(block, ind);
+        if (ind == block->length && block != rightmost) {
+            block = block->successor();
+            ind = 0;
+        }
+        return iterator(this, ind, block);
+    }
+    /**
+     * removes every element for which pred returns true, keeping the order of the others.
+     * blocks are compacted in one pass and the tree is rebuilt once in O(#blocks).
+     * returns the number of removed elements.
+     */
+    template<class Pred>
+    size_t remove_if(Pred pred) {
+        if (root == nullptr) return 0;
+        size_t removed = 0;
+        try {
+            for (tree_node* block = leftmost; block != nullptr; block = block->successor()) {
+                removed += compact_block(block, pred);
+            }
+        } catch (...) {
+            rebuild(collect_all());
+            throw;
+        }
+        if (removed != 0) rebuild(collect_all());
+        return removed;
+    }
+    /**
+     * moves all elements of other to the end (or to the beginning) of this deque, leaving other empty.
+     * with a transferable Pool (heap_pool, cow_pool) and equal allocators no element is copied or moved:
+     * the storage of every block of other is handed over in O(#blocks of other) and the two trees are joined in O(log n).
+     * otherwise (slab_pool, or different allocators) the elements are moved one by one.
+     * iterators of other are invalidated.
+     */
+    void splice_back(rope_deque &&other) {
+        splice_tree(other, false);
+    }
+    void splice_front(rope_deque &&other) {
+        splice_tree(other, true);
+    }
+    /**
+     * removes [pos, end()) from this deque and returns it as a new deque with the same allocator.
+     * with a transferable Pool (heap_pool, cow_pool) the block of pos is split once, the tree is split in O(log n)
+     * and the storage of the blocks after pos is handed over as it is, O(chunk_size + log n + #blocks moved);
+     * with slab_pool the elements are moved instead, O(end() - pos).
+     * throw if the iterator is invalid or it points to a wrong place.
+     */
+    rope_deque split_at(iterator pos) {
+        ensure_tree(pos);
+        if (check_iterator && iterator_not_exist(pos)) throw invalid_iterator();
+        rope_deque result(up.alloc);
+        result.set_block_cache_limit(cache_limit);
+        if (pos == end()) return result;
+        if (!Pool::transferable) {
+            for (iterator it = pos; it != end(); ++it) result.emplace_back(std::move(*it));
+            erase(pos, end());
+            return result;
+        }
+        tree_node* block = pos.node;
+        //先准备好 result 接住 block 用的结点，以及整棵树都被拿走时自己剩下的空 block
+        size_t count = 0;
+        for (tree_node* x = block; x != nullptr; x = x->successor()) count++;
+        tree_node* nodes = result.take_nodes(count);
+        tree_node* empty = nullptr;
+        if (pos.cur_ind == 0 && block == leftmost) empty = new_block();
+        if (pos.cur_ind > 0) {
+            spilt(block, pos.cur_ind);
+            block = block->successor();
+        }
+        tree_node* prefix;
+        tree_node* suffix;
+        split(root, index_of(block, 0), prefix, suffix);
+        suffix->parent = nullptr;
+        result.cache_block(result.root);
+        tree_node* last;
+        result.root = result.take_blocks(*this, collect(block), nodes, last);
+        result.leftmost = result.root;
+        while (result.leftmost->left != nullptr) result.leftmost = result.leftmost->left;
+        result.rightmost = last;
+        if (empty != nullptr) {
+            init_tree(empty);
+        } else {
+            prefix->parent = nullptr;
+            root = prefix;
+            for (rightmost = root; rightmost->right != nullptr; rightmost = rightmost->right);
+            size_t ind = rightmost->length;
+            tree_node* prefix_last = rightmost;
+            maintainBlock(prefix_last, ind);
+        }
+        tree_node* first = result.leftmost;
+        size_t ind = 0;
+        result.maintainBlock(first, ind);
+        return result;
+    }
+    void push_back(const T &value) {
+        emplace_back(value);
+    }
+    void push_back(T &&value) {
+        emplace_back(std::move(value));
+    }
+    template<class... Args>
+    T &emplace_back(Args&&... args) {
+        ensure_tree();
+        tree_node* node = rightmost;
+        construct_in(node, node->length, std::forward<Args>(args)...);
+        if (node->length >= node->capacity()) spilt(node, node->capacity() >> 1);
+        return *rightmost->get(rightmost->length - 1);
+    }
+    /**
+     * throw when the container is empty.
+     */
+    void pop_back() {
+        if (size() == 0) throw container_is_empty();
+        tree_node* node = rightmost;
+        alloc_traits::destroy(up.alloc, node->get(node->length - 1));
+        node->remove(node->length - 1);
+        add_up(node, size_t(-1));
+        if (node->length == 0) {
+            if (node != leftmost) remove_block(node);
+        } else if (node != leftmost) {
+            tree_node* prev = node->predecessor();
+            if (prev->length + node->length <= (prev->capacity() >> 1)) merge(prev, node);
+        }
+    }
+    void push_front(const T &value) {
+        emplace_front(value);
+    }
+    void push_front(T &&value) {
+        emplace_front(std::move(value));
+    }
+    template<class... Args>
+    T &emplace_front(Args&&... args) {
+        ensure_tree();
+        tree_node* node = leftmost;
+        construct_in(node, 0, std::forward<Args>(args)...);
+        if (node->length >= node->capacity()) spilt(node, node->capacity() >> 1);
+        return *leftmost->get(0);
+    }
+    void pop_front() {
+        if (size() == 0) throw container_is_empty();
+        tree_node* node = leftmost;
+        alloc_traits::destroy(up.alloc, node->get(0));
+        node->remove(0);
+        add_up(node, size_t(-1));
+        if (node->length == 0) {
+            if (node != rightmost) remove_block(node);
+        } else if (node != rightmost) {
+            tree_node* next = node->successor();
+            if (node->length + next->length <= (node->capacity() >> 1)) merge(node, next);
+        }
+    }
+};
+
+template<class T, class Allocator, class Pool, size_t ChunkSize, bool CheckIterators>
+void swap(rope_deque<T, Allocator, Pool, ChunkSize, CheckIterators> &lhs,
+          rope_deque<T, Allocator, Pool, ChunkSize, CheckIterators> &rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+template<class T, class Allocator, class Pool, size_t ChunkSize, bool CheckIterators, class Pred>
+size_t erase_if(rope_deque<T, Allocator, Pool, ChunkSize, CheckIterators> &d, Pred pred) {
+    return d.remove_if(pred);
+}
+
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef SJTU_SPSC_DEQUE_HPP
+#define SJTU_SPSC_DEQUE_HPP
+
+#include "deque.hpp"
+
+#include <atomic>
+
+namespace sjtu {
+/**
+ * spsc_deque：一个生产者线程、一个消费者线程之间传递元素用的无锁队列，不需要 mutex。
+ * 元素与 deque 一样放在 ChunkSize 个一组的 block 里，block 串成单向链表：
+ * 生产者只在最后一个 block 的末尾 push_back，消费者只从第一个 block 的开头 pop_front，
+ * 两个线程之间只通过原子计数器（push 和 pop 过的元素总数）通信，每次操作都是 O(1) 且不含 CAS。
+ * 消费者读完的 block 经过一个同样只有两个计数器的小环形数组交还给生产者复用，稳定运行时不再申请内存；
+ * 环形数组放满时消费者直接释放多出来的 block，所以 Allocator 需要允许在两个线程中分别 allocate 和 deallocate。
+ * push_back、emplace_back 只能由生产者调用，front、pop_front、try_pop_front 只能由消费者调用，
+ * size、empty 两边都可以调用，但得到的只是调用时的近似值。
+ */
+template<class T, class Allocator = std::allocator<T>, size_t ChunkSize = default_chunk_size<T>::value>
+class spsc_deque {
+public:
+    static const size_t chunk_size = ChunkSize;
+    static_assert(ChunkSize >= 4, "a block must hold at least 4 elements");
+private:
+    static const size_t cache_line = 64;
+    //最多缓存多少个读完的 block
+    static const size_t spare_slots = 16;
+    struct block {
+        //链表中的下一个 block，在 pushed 发布之前写好，所以不需要是原子的
+        block* next;
+        alignas(T) unsigned char storage[ChunkSize * sizeof(T)];
+        T* data() { return reinterpret_cast<T*>(storage); }
+    };
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<block> block_allocator;
+    typedef std::allocator_traits<block_allocator> block_traits;
+    Allocator alloc;
+    //和 steal_deque 一样用填充而不是 alignas 把两个线程的数据分在不同的 cache line 上，
+    //这样在 C++17 之前 new 出来的 spsc_deque（或者包含它的对象）也不会因为对齐要求超出默认值而出错
+    char pad_front[cache_line];
+    //生产者的数据：最后一个 block，其中已经用掉的位置数，push 过的元素总数（pushed 的本地副本）
+    block* back_block;
+    size_t back_ind;
+    size_t push_count;
+    std::atomic<size_t> pushed;
+    //生产者从 spare 中取走过的 block 数
+    std::atomic<size_t> spare_taken;
+    char pad_producer[cache_line];
+    //消费者的数据：第一个 block，其中已经读掉的位置数，pop 过的元素总数，以及上一次读到的 pushed
+    block* front_block;
+    size_t front_ind;
+    size_t pop_count;
+    size_t pushed_cache;
+    std::atomic<size_t> popped;
+    //消费者放进 spare 的 block 数
+    std::atomic<size_t> spare_given;
+    char pad_consumer[cache_line];
+    //消费者读完的 block 放在这里等生产者取走，[spare_taken, spare_given) 是其中的 block；
+    //每个格子在 spare_given 发布之前写好、在 spare_taken 发布之后才会被覆盖，所以不需要是原子的
+    block* spare[spare_slots];
+
+    block* allocate_block() {
+        block_allocator a(alloc);
+        block* b = block_traits::allocate(a, 1);
+        b->next = nullptr;
+        return b;
+    }
+    void deallocate_block(block* b) {
+        block_allocator a(alloc);
+        block_traits::deallocate(a, b, 1);
+    }
+    //生产者：取一个空的 block，spare 为空时才申请内存
+    block* new_block() {
+        size_t taken = spare_taken.load(std::memory_order_relaxed);
+        if (taken == spare_given.load(std::memory_order_acquire)) return allocate_block();
+        block* b = spare[taken % spare_slots];
+        spare_taken.store(taken + 1, std::memory_order_release);
+        b->next = nullptr;
+        return b;
+    }
+    //消费者：把读完的 block 交给生产者，spare 已满时直接释放
+    void recycle_block(block* b) {
+        size_t given = spare_given.load(std::memory_order_relaxed);
+        if (given - spare_taken.load(std::memory_order_acquire) == spare_slots) {
+            deallocate_block(b);
+            return;
+        }
+        spare[given % spare_slots] = b;
+        spare_given.store(given + 1, std::memory_order_release);
+    }
+    //消费者：第一个元素的位置，容器为空时返回 nullptr；读完的 block 在这里交还
+    T* front_slot() {
+        if (pop_count == pushed_cache) {
+            pushed_cache = pushed.load(std::memory_order_acquire);
+            if (pop_count == pushed_cache) return nullptr;
+        }
+        if (front_ind == ChunkSize) {
+            block* old = front_block;
+            front_block = old->next;
+            front_ind = 0;
+            recycle_block(old);
+        }
+        return front_block->data() + front_ind;
+    }
+    void discard_front(T* p) {
+        alloc_traits::destroy(alloc, p);
+        front_ind++;
+        pop_count++;
+        popped.store(pop_count, std::memory_order_release);
+    }
+public:
+    explicit spsc_deque(const Allocator &a = Allocator()):alloc(a), back_ind(0), push_count(0), pushed(0), spare_taken(0),
+    front_ind(0), pop_count(0), pushed_cache(0), popped(0), spare_given(0) {
+        back_block = front_block = allocate_block();
+    }
+    spsc_deque(const spsc_deque &other) = delete;
+    spsc_deque &operator=(const spsc_deque &other) = delete;
+    /**
+     * must not run concurrently with either thread.
+     */
+    ~spsc_deque() {
+        while (T* p = front_slot()) discard_front(p);
+        deallocate_block(front_block);
+        size_t given = spare_given.load(std::memory_order_acquire);
+        for (size_t i = spare_taken.load(std::memory_order_relaxed); i != given; ++i) deallocate_block(spare[i % spare_slots]);
+    }
+    /**
+     * producer only. constructs an element at the end, O(1); never blocks.
+     */
+    template<class... Args>
+    void emplace_back(Args&&... args) {
+        if (back_ind == ChunkSize) {
+            block* b = new_block();
+            back_block->next = b;
+            back_block = b;
+            back_ind = 0;
+        }
+        alloc_traits::construct(alloc, back_block->data() + back_ind, std::forward<Args>(args)...);
+        back_ind++;
+        push_count++;
+        pushed.store(push_count, std::memory_order_release);
+    }
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+    /**
+     * consumer only. moves the first element into value and removes it;
+     * returns false if no element is available yet.
+     */
+    bool try_pop_front(T &value) {
+        T* p = front_slot();
+        if (p == nullptr) return false;
+        value = std::move(*p);
+        discard_front(p);
+        return true;
+    }
+    /**
+     * consumer only.
+     * throw container_is_empty if no element is available yet.
+     */
+    T & front() {
+        T* p = front_slot();
+        if (p == nullptr) throw container_is_empty();
+        return *p;
+    }
+    void pop_front() {
+        T* p = front_slot();
+        if (p == nullptr) throw container_is_empty();
+        discard_front(p);
+    }
+    size_t size() const {
+        size_t out = popped.load(std::memory_order_acquire);
+        return pushed.load(std::memory_order_acquire) - out;
+    }
+    bool empty() const { return size() == 0; }
+};
+
+}
+
+#endif
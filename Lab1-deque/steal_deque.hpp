@@ -0,0 +1,161 @@
+#ifndef SJTU_STEAL_DEQUE_HPP
+#define SJTU_STEAL_DEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace sjtu {
+/**
+ * steal_deque：work-stealing 调度用的 Chase-Lev deque。
+ * 一个拥有者线程在 bottom 端 push_back、try_pop_back（不加锁，只有最后一个元素时才需要一次 CAS），
+ * 任意多个其他线程在 top 端 try_steal（一次 CAS），所有操作都是 O(1)（扩容时均摊 O(1)）。
+ * 元素放在长度为 2 的幂的环形数组中，满了以后换成两倍大的数组；
+ * 旧数组可能还有 thief 在读，所以不立即释放，而是串起来等到 steal_deque 析构时一起释放（总大小不超过当前数组）。
+ * 元素按值保存在 std::atomic<T> 中，所以 T 必须是 trivially copyable 的，通常是指向任务的指针。
+ */
+template<class T, class Allocator = std::allocator<T>>
+class steal_deque {
+    static_assert(std::is_trivially_copyable<T>::value, "steal_deque stores elements in std::atomic<T>");
+private:
+    static const size_t cache_line = 64;
+    struct ring {
+        size_t mask;
+        std::atomic<T>* slots;
+        //换下来的上一个数组
+        ring* retired;
+        T get(long long ind) const { return slots[size_t(ind) & mask].load(std::memory_order_relaxed); }
+        void put(long long ind, T value) { slots[size_t(ind) & mask].store(value, std::memory_order_relaxed); }
+    };
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<ring> ring_allocator;
+    typedef std::allocator_traits<ring_allocator> ring_traits;
+    typedef typename alloc_traits::template rebind_alloc<std::atomic<T>> slot_allocator;
+    typedef std::allocator_traits<slot_allocator> slot_traits;
+    Allocator alloc;
+    //thief 从 top 取，拥有者在 bottom 放和取，[top, bottom) 是当前的元素
+    //用填充而不是 alignas 把 top 和 bottom 分在不同的 cache line 上，这样 steal_deque 可以直接放在 new 出来的数组里
+    char pad_front[cache_line];
+    std::atomic<long long> top;
+    char pad_top[cache_line];
+    std::atomic<long long> bottom;
+    std::atomic<ring*> array;
+    char pad_back[cache_line];
+
+    ring* new_ring(size_t capacity, ring* retired) {
+        ring_allocator ra(alloc);
+        slot_allocator sa(alloc);
+        ring* r = ring_traits::allocate(ra, 1);
+        try {
+            r->slots = slot_traits::allocate(sa, capacity);
+        } catch (...) {
+            ring_traits::deallocate(ra, r, 1);
+            throw;
+        }
+        for (size_t i = 0; i < capacity; ++i) slot_traits::construct(sa, r->slots + i);
+        r->mask = capacity - 1;
+        r->retired = retired;
+        return r;
+    }
+    void delete_ring(ring* r) {
+        ring_allocator ra(alloc);
+        slot_allocator sa(alloc);
+        for (size_t i = 0; i <= r->mask; ++i) slot_traits::destroy(sa, r->slots + i);
+        slot_traits::deallocate(sa, r->slots, r->mask + 1);
+        ring_traits::deallocate(ra, r, 1);
+    }
+    //拥有者：把 [t, b) 复制到两倍大的数组中，旧数组挂在新数组的 retired 上
+    ring* grow(ring* old, long long t, long long b) {
+        ring* r = new_ring((old->mask + 1) * 2, old);
+        for (long long i = t; i < b; ++i) r->put(i, old->get(i));
+        array.store(r, std::memory_order_release);
+        return r;
+    }
+public:
+    /**
+     * capacity is the initial size of the ring, rounded up to a power of two.
+     */
+    explicit steal_deque(size_t capacity = 64, const Allocator &a = Allocator()):alloc(a), top(0), bottom(0), array(nullptr) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        array.store(new_ring(cap, nullptr), std::memory_order_relaxed);
+    }
+    steal_deque(const steal_deque &other) = delete;
+    steal_deque &operator=(const steal_deque &other) = delete;
+    /**
+     * must not run concurrently with the owner or any thief.
+     */
+    ~steal_deque() {
+        ring* r = array.load(std::memory_order_relaxed);
+        while (r != nullptr) {
+            ring* retired = r->retired;
+            delete_ring(r);
+            r = retired;
+        }
+    }
+    /**
+     * owner only. adds value at the bottom, growing the ring if it is full.
+     */
+    void push_back(T value) {
+        long long b = bottom.load(std::memory_order_relaxed);
+        long long t = top.load(std::memory_order_acquire);
+        ring* r = array.load(std::memory_order_relaxed);
+        if (b - t > (long long)r->mask) r = grow(r, t, b);
+        r->put(b, value);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+    /**
+     * owner only. takes the element at the bottom (the one pushed last);
+     * returns false, leaving value untouched, if the deque is empty or a thief took the last element first.
+     */
+    bool try_pop_back(T &value) {
+        long long b = bottom.load(std::memory_order_relaxed) - 1;
+        ring* r = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        T x = r->get(b);
+        if (t == b) {
+            //只剩最后一个元素，和 thief 抢；抢输了 value 保持不变
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            if (!won) return false;
+        }
+        value = x;
+        return true;
+    }
+    /**
+     * any thread. takes the element at the top (the oldest);
+     * returns false, leaving value untouched, if the deque is empty or another thread took it first.
+     */
+    bool try_steal(T &value) {
+        long long t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+        ring* r = array.load(std::memory_order_acquire);
+        T x = r->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return false;
+        value = x;
+        return true;
+    }
+    /**
+     * approximate when other threads are pushing, popping or stealing.
+     */
+    size_t size() const {
+        long long b = bottom.load(std::memory_order_acquire);
+        long long t = top.load(std::memory_order_acquire);
+        return b > t ? size_t(b - t) : 0;
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return array.load(std::memory_order_acquire)->mask + 1; }
+};
+
+}
+
+#endif
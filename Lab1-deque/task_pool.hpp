@@ -0,0 +1,368 @@
+#ifndef SJTU_TASK_POOL_HPP
+#define SJTU_TASK_POOL_HPP
+
+#include "deque.hpp"
+#include "steal_deque.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace sjtu {
+class task_group;
+/**
+ * task_pool：固定数量的工作线程加上 work-stealing 的最小调度器。
+ * 每个工作线程有一个 steal_deque，自己 spawn 的任务放在 bottom 端并按 LIFO 顺序执行，
+ * 空闲时随机选一个其他线程从它的 top 端偷最老（通常也是最大）的任务；
+ * 不在工作线程中提交的任务放进一个加锁的 deque，由工作线程取走。
+ * 没有任务可做的工作线程在 condition_variable 上睡眠，提交任务时只有存在睡眠的线程才需要加锁唤醒。
+ * 任务对象从每个工作线程自己的空闲链表中取，可调用对象不超过 task::inline_size 字节时直接构造在任务对象里，
+ * 所以稳定运行时 spawn 不申请内存。
+ * 任务通过 task_group 提交和等待，见 task_group。
+ */
+class task_pool {
+    friend class task_group;
+private:
+    struct task {
+        static const size_t inline_size = 48;
+        //run 为 true 时调用 storage 中的可调用对象，然后析构它；为 false 时只析构（任务没能提交）
+        void (*invoke)(task* t, bool run);
+        task_group* group;
+        //在空闲链表中时的下一个任务对象
+        task* next;
+        //放得下的可调用对象直接构造在这里，放不下的在这里保存指向堆上对象的指针
+        alignas(std::max_align_t) unsigned char storage[inline_size];
+    };
+    //每个工作线程最多缓存多少个执行完的任务对象，多出来的直接释放
+    static const size_t task_cache = 256;
+    struct worker {
+        steal_deque<task*> tasks;
+        std::thread thread;
+        //选择 victim 用的 xorshift 状态
+        unsigned long long seed;
+        //执行完的任务对象，只有这个工作线程自己访问
+        task* free_tasks;
+        size_t free_count;
+        worker():seed(0), free_tasks(nullptr), free_count(0) {}
+    };
+    worker* workers;
+    size_t worker_count;
+    //外部线程提交的任务
+    std::mutex inject_mutex;
+    deque<task*> injected;
+    std::atomic<size_t> injected_count;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<size_t> sleeping;
+    std::atomic<bool> stopping;
+    //在 task_group::wait 中睡眠的非工作线程；task_group 可能在 pending 归零后立即被销毁，所以用 task_pool 的
+    std::mutex wait_mutex;
+    std::condition_variable done;
+    std::atomic<size_t> waiting;
+
+    //当前线程是哪个 task_pool 的哪个工作线程
+    static task_pool*& current_pool() {
+        static thread_local task_pool* pool = nullptr;
+        return pool;
+    }
+    static worker*& current_worker() {
+        static thread_local worker* w = nullptr;
+        return w;
+    }
+    worker* self() const {
+        return current_pool() == this ? current_worker() : nullptr;
+    }
+    template<class F>
+    static void invoke_inline(task* t, bool run) {
+        F &f = *reinterpret_cast<F*>(t->storage);
+        try {
+            if (run) f();
+        } catch (...) {
+            f.~F();
+            throw;
+        }
+        f.~F();
+    }
+    template<class F>
+    static void invoke_boxed(task* t, bool run) {
+        F* f = *reinterpret_cast<F**>(t->storage);
+        try {
+            if (run) (*f)();
+        } catch (...) {
+            delete f;
+            throw;
+        }
+        delete f;
+    }
+    template<class F, class G>
+    static void emplace_callable(task* t, G &&g, std::true_type) {
+        ::new (static_cast<void*>(t->storage)) F(std::forward<G>(g));
+        t->invoke = &invoke_inline<F>;
+    }
+    template<class F, class G>
+    static void emplace_callable(task* t, G &&g, std::false_type) {
+        *reinterpret_cast<F**>(t->storage) = new F(std::forward<G>(g));
+        t->invoke = &invoke_boxed<F>;
+    }
+    //在工作线程中优先复用执行完的任务对象
+    template<class G>
+    task* new_task(G &&g, task_group* group) {
+        typedef typename std::decay<G>::type F;
+        typedef std::integral_constant<bool, sizeof(F) <= task::inline_size && alignof(F) <= alignof(std::max_align_t)> fits;
+        worker* w = self();
+        task* t;
+        if (w != nullptr && w->free_tasks != nullptr) {
+            t = w->free_tasks;
+            w->free_tasks = t->next;
+            w->free_count--;
+        } else {
+            t = new task;
+        }
+        try {
+            emplace_callable<F>(t, std::forward<G>(g), fits());
+        } catch (...) {
+            delete_task(t);
+            throw;
+        }
+        t->group = group;
+        return t;
+    }
+    void delete_task(task* t) {
+        worker* w = self();
+        if (w != nullptr && w->free_count < task_cache) {
+            t->next = w->free_tasks;
+            w->free_tasks = t;
+            w->free_count++;
+        } else {
+            delete t;
+        }
+    }
+    bool has_work() const {
+        if (injected_count.load(std::memory_order_acquire) != 0) return true;
+        for (size_t i = 0; i < worker_count; ++i)
+            if (!workers[i].tasks.empty()) return true;
+        return false;
+    }
+    void submit(task* t) {
+        worker* w = self();
+        if (w != nullptr) {
+            w->tasks.push_back(t);
+        } else {
+            std::lock_guard<std::mutex> lock(inject_mutex);
+            injected.push_back(t);
+            injected_count.fetch_add(1, std::memory_order_release);
+        }
+        //与 idle 中的 sleeping++ 和 has_work 配对：要么对方看到了这个任务，要么这里看到了对方在睡眠
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed) != 0) {
+            { std::lock_guard<std::mutex> lock(sleep_mutex); }
+            wake.notify_one();
+        }
+    }
+    //取一个任务：先取自己的，再从随机的 victim 开始依次偷，最后取外部提交的
+    task* find_task(worker* w) {
+        task* t = nullptr;
+        if (w != nullptr && w->tasks.try_pop_back(t)) return t;
+        size_t start = 0;
+        if (w != nullptr) {
+            w->seed ^= w->seed << 13;
+            w->seed ^= w->seed >> 7;
+            w->seed ^= w->seed << 17;
+            start = size_t(w->seed % worker_count);
+        }
+        for (size_t i = 0; i < worker_count; ++i) {
+            worker &victim = workers[(start + i) % worker_count];
+            if (&victim != w && victim.tasks.try_steal(t)) return t;
+        }
+        if (injected_count.load(std::memory_order_acquire) != 0) {
+            std::lock_guard<std::mutex> lock(inject_mutex);
+            if (!injected.empty()) {
+                t = injected.front();
+                injected.pop_front();
+                injected_count.fetch_sub(1, std::memory_order_relaxed);
+                return t;
+            }
+        }
+        return nullptr;
+    }
+    inline void execute(task* t);
+    bool run_one(worker* w) {
+        task* t = find_task(w);
+        if (t == nullptr) return false;
+        execute(t);
+        return true;
+    }
+    void idle() {
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleeping.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!stopping.load(std::memory_order_acquire) && !has_work()) wake.wait(lock);
+        sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+    void work(worker* w) {
+        current_pool() = this;
+        current_worker() = w;
+        while (!stopping.load(std::memory_order_acquire)) {
+            if (run_one(w)) continue;
+            //先让出几次时间片，仍然没有任务再睡眠
+            bool found = false;
+            for (int i = 0; i < 64 && !found; ++i) {
+                std::this_thread::yield();
+                found = run_one(w);
+            }
+            if (!found) idle();
+        }
+        current_pool() = nullptr;
+        current_worker() = nullptr;
+    }
+public:
+    /**
+     * starts threads worker threads (at least one; 0 means one per hardware thread).
+     */
+    explicit task_pool(size_t threads = 0):workers(nullptr), worker_count(0), injected_count(0), sleeping(0), stopping(false),
+    waiting(0) {
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+        workers = new worker[threads];
+        worker_count = threads;
+        for (size_t i = 0; i < threads; ++i) workers[i].seed = 0x9e3779b97f4a7c15ull * (i + 1);
+        try {
+            for (size_t i = 0; i < threads; ++i) workers[i].thread = std::thread(&task_pool::work, this, workers + i);
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+    task_pool(const task_pool &other) = delete;
+    task_pool &operator=(const task_pool &other) = delete;
+    /**
+     * every task_group must have been waited on before the pool is destroyed.
+     */
+    ~task_pool() {
+        stop();
+    }
+    size_t size() const { return worker_count; }
+    /**
+     * runs f on the pool and waits until it and every task it spawned into the same group finish.
+     */
+    template<class F>
+    inline void run(F &&f);
+private:
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            wake.notify_all();
+        }
+        for (size_t i = 0; i < worker_count; ++i) {
+            if (workers[i].thread.joinable()) workers[i].thread.join();
+            while (task* t = workers[i].free_tasks) {
+                workers[i].free_tasks = t->next;
+                delete t;
+            }
+        }
+        delete[] workers;
+        workers = nullptr;
+        worker_count = 0;
+    }
+};
+/**
+ * task_group：一组 fork-join 任务。spawn 提交一个任务，wait 等待这组中已经提交的任务全部完成；
+ * 在工作线程中等待时当前线程也会执行任务（自己的、偷来的或外部提交的），所以在任务中嵌套 spawn 和 wait 不会死锁；
+ * 在其他线程中等待时则在 condition_variable 上睡眠，直到这组的最后一个任务完成时被唤醒。
+ * 任务抛出的第一个异常在 wait 中重新抛出，其余的被丢弃。
+ */
+class task_group {
+    friend class task_pool;
+private:
+    task_pool &pool;
+    std::atomic<size_t> pending;
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+
+    void fail(std::exception_ptr e) {
+        if (!failed.exchange(true, std::memory_order_acq_rel)) error = e;
+    }
+    void join() {
+        task_pool::worker* w = pool.self();
+        if (w != nullptr) {
+            while (pending.load(std::memory_order_acquire) != 0)
+                if (!pool.run_one(w)) std::this_thread::yield();
+            return;
+        }
+        //与 task_pool::execute 配对：要么这里看到 pending 归零，要么对方看到 waiting 不为 0 并在加锁后唤醒
+        pool.waiting.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(pool.wait_mutex);
+            while (pending.load(std::memory_order_seq_cst) != 0) pool.done.wait(lock);
+        }
+        pool.waiting.fetch_sub(1, std::memory_order_relaxed);
+    }
+public:
+    explicit task_group(task_pool &host_pool):pool(host_pool), pending(0), failed(false) {}
+    task_group(const task_group &other) = delete;
+    task_group &operator=(const task_group &other) = delete;
+    /**
+     * waits for the remaining tasks; their exceptions are dropped.
+     */
+    ~task_group() {
+        join();
+    }
+    template<class F>
+    void spawn(F &&f) {
+        task_pool::task* t = pool.new_task(std::forward<F>(f), this);
+        pending.fetch_add(1, std::memory_order_relaxed);
+        try {
+            pool.submit(t);
+        } catch (...) {
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            t->invoke(t, false);
+            pool.delete_task(t);
+            throw;
+        }
+    }
+    /**
+     * rethrows the first exception thrown by a task of this group, if any.
+     */
+    void wait() {
+        join();
+        if (failed.load(std::memory_order_acquire)) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            failed.store(false, std::memory_order_relaxed);
+            std::rethrow_exception(e);
+        }
+    }
+};
+
+inline void task_pool::execute(task* t) {
+    task_group* group = t->group;
+    try {
+        t->invoke(t, true);
+    } catch (...) {
+        group->fail(std::current_exception());
+    }
+    delete_task(t);
+    //pending 归零后 group 可能立即被销毁，这是最后一次访问 group；之后只用 task_pool 的成员唤醒等待的线程
+    if (group->pending.fetch_sub(1, std::memory_order_seq_cst) == 1 && waiting.load(std::memory_order_seq_cst) != 0) {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        done.notify_all();
+    }
+}
+
+template<class F>
+inline void task_pool::run(F &&f) {
+    task_group group(*this);
+    group.spawn(std::forward<F>(f));
+    group.wait();
+}
+
+}
+
+#endif